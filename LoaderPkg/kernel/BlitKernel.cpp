@@ -0,0 +1,301 @@
+//
+// include files
+//
+#include "BlitKernel.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <cpuid.h>
+#include <emmintrin.h>
+
+namespace blit
+{
+//
+// static function declaration
+//
+namespace
+{
+    void CopyRowScalar( uint32_t* dst, const uint32_t* src, int n, bool stream );
+    void FillRowScalar( uint32_t* dst, uint32_t value, int n, bool stream );
+    void CopyRowKeyedScalar( uint32_t* dst, const uint32_t* src, int n, uint32_t key );
+    void BlendRowOverScalar( uint32_t* dst, const uint32_t* src, int n );
+
+    void CopyRowSSE2( uint32_t* dst, const uint32_t* src, int n, bool stream );
+    void FillRowSSE2( uint32_t* dst, uint32_t value, int n, bool stream );
+    void CopyRowKeyedSSE2( uint32_t* dst, const uint32_t* src, int n, uint32_t key );
+    void BlendRowOverSSE2( uint32_t* dst, const uint32_t* src, int n );
+
+    struct Kernel
+    {
+        const char* Name;
+        void (*CopyRow)( uint32_t*, const uint32_t*, int, bool );
+        void (*FillRow)( uint32_t*, uint32_t, int, bool );
+        void (*CopyRowKeyed)( uint32_t*, const uint32_t*, int, uint32_t );
+        void (*BlendRowOver)( uint32_t*, const uint32_t*, int );
+    };
+}
+
+//
+// static variables
+//
+namespace
+{
+    constexpr Kernel k_ScalarKernel { "scalar", CopyRowScalar, FillRowScalar, CopyRowKeyedScalar, BlendRowOverScalar };
+    constexpr Kernel k_SSE2Kernel   { "sse2",   CopyRowSSE2,   FillRowSSE2,   CopyRowKeyedSSE2,   BlendRowOverSSE2 };
+
+    //! ネイティブ形式の色成分 (上位 8bit 以外)
+    constexpr uint32_t k_ColorMask = 0x00ffffff;
+
+    // Initialize() 前に描画されてもよいようにスカラー版で始める
+    const Kernel* s_Kernel = &k_ScalarKernel;
+}
+
+//
+// funcion definitions
+//
+namespace
+{
+    void CopyRowScalar( uint32_t* dst, const uint32_t* src, int n, bool stream )
+    {
+        memcpy( dst, src, sizeof(uint32_t) * n );
+    }
+
+    void FillRowScalar( uint32_t* dst, uint32_t value, int n, bool stream )
+    {
+        for( int i = 0; i < n; ++i ){
+            dst[i] = value;
+        }
+    }
+
+    void CopyRowKeyedScalar( uint32_t* dst, const uint32_t* src, int n, uint32_t key )
+    {
+        for( int i = 0; i < n; ++i ){
+            if( src[i] != key ){
+                dst[i] = src[i];
+            }
+        }
+    }
+
+    //! @brief x / 255 を丸めて求める (x は 0 - 65535)
+    uint32_t Div255( uint32_t x )
+    {
+        x += 128;
+        return (x + (x >> 8)) >> 8;
+    }
+
+    void BlendRowOverScalar( uint32_t* dst, const uint32_t* src, int n )
+    {
+        for( int i = 0; i < n; ++i ){
+            const uint32_t s = src[i];
+            const uint32_t t = s >> 24;
+            if( t == 0 ){
+                dst[i] = s;
+                continue;
+            }
+            if( t == 255 ){
+                continue;
+            }
+
+            const uint32_t d = dst[i];
+            uint32_t v = 0;
+            for( int shift = 0; shift < 24; shift += 8 ){
+                const uint32_t c = ((s >> shift) & 0xff) + Div255( ((d >> shift) & 0xff) * t );
+                v |= std::min<uint32_t>( c, 0xff ) << shift;
+            }
+            dst[i] = v;
+        }
+    }
+
+    bool IsAligned16( const void* p )
+    {
+        return (reinterpret_cast<uintptr_t>(p) & 0xf) == 0;
+    }
+
+    void CopyRowSSE2( uint32_t* dst, const uint32_t* src, int n, bool stream )
+    {
+        int i = 0;
+        if( stream ){
+            // movntdq は 16byte 境界が必要なので先頭は movnti で合わせる
+            for( ; i < n && !IsAligned16( dst + i ); ++i ){
+                _mm_stream_si32( reinterpret_cast<int*>(dst + i), static_cast<int>(src[i]) );
+            }
+            for( ; i + 4 <= n; i += 4 ){
+                const __m128i v = _mm_loadu_si128( reinterpret_cast<const __m128i*>(src + i) );
+                _mm_stream_si128( reinterpret_cast<__m128i*>(dst + i), v );
+            }
+            for( ; i < n; ++i ){
+                _mm_stream_si32( reinterpret_cast<int*>(dst + i), static_cast<int>(src[i]) );
+            }
+            return;
+        }
+
+        for( ; i + 16 <= n; i += 16 ){
+            const __m128i v0 = _mm_loadu_si128( reinterpret_cast<const __m128i*>(src + i) );
+            const __m128i v1 = _mm_loadu_si128( reinterpret_cast<const __m128i*>(src + i + 4) );
+            const __m128i v2 = _mm_loadu_si128( reinterpret_cast<const __m128i*>(src + i + 8) );
+            const __m128i v3 = _mm_loadu_si128( reinterpret_cast<const __m128i*>(src + i + 12) );
+            _mm_storeu_si128( reinterpret_cast<__m128i*>(dst + i), v0 );
+            _mm_storeu_si128( reinterpret_cast<__m128i*>(dst + i + 4), v1 );
+            _mm_storeu_si128( reinterpret_cast<__m128i*>(dst + i + 8), v2 );
+            _mm_storeu_si128( reinterpret_cast<__m128i*>(dst + i + 12), v3 );
+        }
+        for( ; i + 4 <= n; i += 4 ){
+            const __m128i v = _mm_loadu_si128( reinterpret_cast<const __m128i*>(src + i) );
+            _mm_storeu_si128( reinterpret_cast<__m128i*>(dst + i), v );
+        }
+        for( ; i < n; ++i ){
+            dst[i] = src[i];
+        }
+    }
+
+    void FillRowSSE2( uint32_t* dst, uint32_t value, int n, bool stream )
+    {
+        const __m128i v = _mm_set1_epi32( static_cast<int>(value) );
+        int i = 0;
+        for( ; i < n && !IsAligned16( dst + i ); ++i ){
+            dst[i] = value;
+        }
+        if( stream ){
+            for( ; i + 4 <= n; i += 4 ){
+                _mm_stream_si128( reinterpret_cast<__m128i*>(dst + i), v );
+            }
+        }
+        else {
+            for( ; i + 16 <= n; i += 16 ){
+                _mm_store_si128( reinterpret_cast<__m128i*>(dst + i), v );
+                _mm_store_si128( reinterpret_cast<__m128i*>(dst + i + 4), v );
+                _mm_store_si128( reinterpret_cast<__m128i*>(dst + i + 8), v );
+                _mm_store_si128( reinterpret_cast<__m128i*>(dst + i + 12), v );
+            }
+            for( ; i + 4 <= n; i += 4 ){
+                _mm_store_si128( reinterpret_cast<__m128i*>(dst + i), v );
+            }
+        }
+        for( ; i < n; ++i ){
+            dst[i] = value;
+        }
+    }
+
+    void CopyRowKeyedSSE2( uint32_t* dst, const uint32_t* src, int n, uint32_t key )
+    {
+        const __m128i k = _mm_set1_epi32( static_cast<int>(key) );
+        int i = 0;
+        for( ; i + 4 <= n; i += 4 ){
+            const __m128i s = _mm_loadu_si128( reinterpret_cast<const __m128i*>(src + i) );
+            const __m128i m = _mm_cmpeq_epi32( s, k );
+            const int mask = _mm_movemask_epi8( m );
+            if( mask == 0xffff ){
+                // 4 ピクセルとも透過
+                continue;
+            }
+            if( mask == 0 ){
+                _mm_storeu_si128( reinterpret_cast<__m128i*>(dst + i), s );
+                continue;
+            }
+            const __m128i d = _mm_loadu_si128( reinterpret_cast<const __m128i*>(dst + i) );
+            const __m128i v = _mm_or_si128( _mm_and_si128( m, d ), _mm_andnot_si128( m, s ) );
+            _mm_storeu_si128( reinterpret_cast<__m128i*>(dst + i), v );
+        }
+        for( ; i < n; ++i ){
+            if( src[i] != key ){
+                dst[i] = src[i];
+            }
+        }
+    }
+
+    void BlendRowOverSSE2( uint32_t* dst, const uint32_t* src, int n )
+    {
+        const __m128i zero  = _mm_setzero_si128();
+        const __m128i full  = _mm_set1_epi32( 255 );
+        const __m128i color = _mm_set1_epi32( static_cast<int>(k_ColorMask) );
+        const __m128i round = _mm_set1_epi16( 128 );
+
+        int i = 0;
+        for( ; i + 4 <= n; i += 4 ){
+            const __m128i s = _mm_loadu_si128( reinterpret_cast<const __m128i*>(src + i) );
+            const __m128i t = _mm_srli_epi32( s, 24 );
+
+            // 4 ピクセルとも不透明ならそのまま，完全に透明なら何もしない
+            if( _mm_movemask_epi8( _mm_cmpeq_epi32( t, zero ) ) == 0xffff ){
+                _mm_storeu_si128( reinterpret_cast<__m128i*>(dst + i), s );
+                continue;
+            }
+            if( _mm_movemask_epi8( _mm_cmpeq_epi32( t, full ) ) == 0xffff ){
+                continue;
+            }
+
+            // 透明度を各ピクセルの 4 成分 (16bit) に広げる
+            const __m128i t_lo = _mm_unpacklo_epi32( _mm_shufflelo_epi16( t, _MM_SHUFFLE(2, 2, 0, 0) ),
+                                                     _mm_shufflelo_epi16( t, _MM_SHUFFLE(2, 2, 0, 0) ) );
+            const __m128i t_hi = _mm_unpackhi_epi32( _mm_shufflehi_epi16( t, _MM_SHUFFLE(2, 2, 0, 0) ),
+                                                     _mm_shufflehi_epi16( t, _MM_SHUFFLE(2, 2, 0, 0) ) );
+
+            const __m128i d = _mm_loadu_si128( reinterpret_cast<const __m128i*>(dst + i) );
+            __m128i d_lo = _mm_add_epi16( _mm_mullo_epi16( _mm_unpacklo_epi8( d, zero ), t_lo ), round );
+            __m128i d_hi = _mm_add_epi16( _mm_mullo_epi16( _mm_unpackhi_epi8( d, zero ), t_hi ), round );
+            d_lo = _mm_srli_epi16( _mm_add_epi16( d_lo, _mm_srli_epi16( d_lo, 8 ) ), 8 );
+            d_hi = _mm_srli_epi16( _mm_add_epi16( d_hi, _mm_srli_epi16( d_hi, 8 ) ), 8 );
+
+            const __m128i v = _mm_adds_epu8( _mm_packus_epi16( d_lo, d_hi ), s );
+            _mm_storeu_si128( reinterpret_cast<__m128i*>(dst + i), _mm_and_si128( v, color ) );
+        }
+        BlendRowOverScalar( dst + i, src + i, n - i );
+    }
+}
+
+void Initialize()
+{
+    unsigned int eax, ebx, ecx, edx;
+    if( __get_cpuid( 1, &eax, &ebx, &ecx, &edx ) && (edx & bit_SSE2) ){
+        s_Kernel = &k_SSE2Kernel;
+    }
+    else {
+        s_Kernel = &k_ScalarKernel;
+    }
+}
+
+const char* KernelName()
+{
+    return s_Kernel->Name;
+}
+
+void CopyRow( uint32_t* dst, const uint32_t* src, int n, bool stream )
+{
+    if( n <= 0 ){
+        return;
+    }
+    s_Kernel->CopyRow( dst, src, n, stream );
+}
+
+void FillRow( uint32_t* dst, uint32_t value, int n, bool stream )
+{
+    if( n <= 0 ){
+        return;
+    }
+    s_Kernel->FillRow( dst, value, n, stream );
+}
+
+void CopyRowKeyed( uint32_t* dst, const uint32_t* src, int n, uint32_t key )
+{
+    if( n <= 0 ){
+        return;
+    }
+    s_Kernel->CopyRowKeyed( dst, src, n, key );
+}
+
+void BlendRowOver( uint32_t* dst, const uint32_t* src, int n )
+{
+    if( n <= 0 ){
+        return;
+    }
+    s_Kernel->BlendRowOver( dst, src, n );
+}
+
+void StoreFence()
+{
+    if( s_Kernel != &k_ScalarKernel ){
+        _mm_sfence();
+    }
+}
+
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+//
+// include headers
+//
+#include <cstdint>
+
+/**
+ * @brief 32bit ピクセル列に対するコピー・塗りつぶし処理
+ *        起動時に CPUID を見て SSE2 版かスカラー版を選ぶ
+ */
+namespace blit
+{
+//
+// functions
+//
+//! @brief CPU の対応命令を調べて使用するカーネルを決定する
+void Initialize();
+//! @brief 選択されたカーネルの名前
+const char* KernelName();
+
+/**
+ * @brief n ピクセルをコピーする (dst と src は重ならないこと)
+ * @param stream  true ならキャッシュを汚さない non-temporal store を使う(VRAM 向け)
+ */
+void CopyRow( uint32_t* dst, const uint32_t* src, int n, bool stream );
+//! @brief n ピクセルを value で埋める
+void FillRow( uint32_t* dst, uint32_t value, int n, bool stream );
+//! @brief n ピクセルをコピーする。ただし src の値が key のピクセルは書き込まない
+void CopyRowKeyed( uint32_t* dst, const uint32_t* src, int n, uint32_t key );
+/**
+ * @brief α 乗算済みの src を dst に重ねる (dst = src + dst * (255 - α) / 255)
+ *        src の上位 8bit は透明度 (255 - α)。dst の上位 8bit は 0 にする
+ */
+void BlendRowOver( uint32_t* dst, const uint32_t* src, int n );
+//! @brief non-temporal store の完了を保証する。stream 指定の書き込み後に呼ぶ
+void StoreFence();
+
+}
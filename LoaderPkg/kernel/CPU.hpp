@@ -0,0 +1,24 @@
+#pragma once
+
+// 
+// include headers
+//
+#include <cstdint>
+
+//
+// constants
+//
+//! @brief CPU毎のデータを保持する配列の要素数
+constexpr int k_MaxCPUs = 1;
+
+//
+// functions
+//
+/**
+ * @brief 現在実行中の CPU 番号を返す
+ *        現状は BSP のみで動作しているので常に 0 を返す
+ */
+inline uint32_t CurrentCPU()
+{
+    return 0;
+}
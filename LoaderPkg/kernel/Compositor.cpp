@@ -0,0 +1,287 @@
+//
+// include files
+//
+#include "Compositor.hpp"
+
+#include <atomic>
+
+#include "Global.hpp"
+#include "Task.hpp"
+#include "Timer.hpp"
+#include "Mouse.hpp"
+#include "InterruptGuard.hpp"
+#include "GfxStat.hpp"
+
+namespace compositor
+{
+//
+// constant
+//
+namespace
+{
+    //! 画面合成を行うフレームタイマ
+    constexpr int k_FrameTimerValue  = 0x6672616d;   // 'fram'
+
+    //! 要求キューの大きさ (2のべき乗)
+    constexpr uint64_t k_QueueSize = 256;
+    //! 全体の再描写要求をビットでまとめるレイヤー ID の上限
+    constexpr LayerID k_PendingDrawLayers = 64;
+}
+
+//
+// static variables
+//
+namespace
+{
+    /**
+     * @brief 要求キューの 1 要素
+     *        Lap は (周回数 * 2) なら書き込み可能，(周回数 * 2 + 1) なら読み出し可能を表す
+     *        0 初期化のままで使えるので，合成タスクの生成前から要求を登録できる
+     */
+    struct Slot
+    {
+        std::atomic<uint64_t> Lap;
+        Request Req;
+    };
+
+    /**
+     * @brief 複数のタスクが登録し，合成タスクだけが取り出す固定長のキュー
+     *        登録は書き込み位置の CAS で要素を確保してから内容を書くので，ロック不要
+     */
+    Slot s_Slots[k_QueueSize];
+    std::atomic<uint64_t> s_EnqueuePos;
+    uint64_t s_DequeuePos;
+
+    //! 全体の再描写を要求されているレイヤー (ビット i がレイヤー ID i)
+    std::atomic<uint64_t> s_PendingDraw;
+    //! キューが一杯で再描写要求を捨てたか。捨てた場合は画面全体を再描写する
+    std::atomic<bool> s_Overflow;
+
+    Task* s_Task = nullptr;
+}
+
+//
+// static function declaration
+//
+namespace
+{
+    bool TryPush( const Request& request );
+    bool TryPop( Request& request );
+    bool IsDamageOnly( Operation op );
+    bool OnCompositorTask();
+    void Apply( const Request& request );
+    void ProcessRequests();
+}
+
+//
+// funcion definitions
+//
+namespace
+{
+    bool TryPush( const Request& request )
+    {
+        uint64_t pos = s_EnqueuePos.load( std::memory_order_relaxed );
+        while( 1 ){
+            Slot& slot = s_Slots[pos % k_QueueSize];
+            const uint64_t lap = slot.Lap.load( std::memory_order_acquire );
+            const uint64_t expect = (pos / k_QueueSize) * 2;
+
+            if( lap == expect ){
+                if( s_EnqueuePos.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) ){
+                    slot.Req = request;
+                    slot.Lap.store( expect + 1, std::memory_order_release );
+                    return true;
+                }
+                // 他のタスクに先を越されたら pos は更新されているのでやり直す
+            }
+            else if( lap < expect ){
+                // 前の周回の要素がまだ取り出されていない
+                return false;
+            }
+            else {
+                pos = s_EnqueuePos.load( std::memory_order_relaxed );
+            }
+        }
+    }
+
+    //! @brief 合成タスクからのみ呼ぶ
+    bool TryPop( Request& request )
+    {
+        Slot& slot = s_Slots[s_DequeuePos % k_QueueSize];
+        const uint64_t expect = (s_DequeuePos / k_QueueSize) * 2 + 1;
+
+        // 位置を確保したタスクがまだ書き込み中なら，次の機会に取り出す
+        if( slot.Lap.load( std::memory_order_acquire ) != expect ){
+            return false;
+        }
+
+        request = slot.Req;
+        slot.Lap.store( expect + 1, std::memory_order_release );
+        ++s_DequeuePos;
+        return true;
+    }
+
+    bool IsDamageOnly( Operation op )
+    {
+        return op == Operation::Draw || op == Operation::DrawArea;
+    }
+
+    bool OnCompositorTask()
+    {
+        return s_Task && &TaskManager::Instance().CurrentTask() == s_Task;
+    }
+
+    void Apply( const Request& request )
+    {
+        switch( request.Op ){
+        case Operation::Draw:
+            g_LayerManager->Draw( request.Layer );
+            break;
+        case Operation::DrawArea:
+            g_LayerManager->Draw( request.Layer, {{request.x, request.y}, {request.w, request.h}} );
+            break;
+        case Operation::Move:
+            g_LayerManager->Move( request.Layer, {request.x, request.y} );
+            break;
+        case Operation::MoveRelative:
+            g_LayerManager->MoveRelative( request.Layer, {request.x, request.y} );
+            break;
+        case Operation::Activate:
+            g_ActiveLayer->Activate( request.Layer );
+            break;
+        default:
+            break;
+        }
+    }
+
+    //! @brief 登録された要求をレイヤーに反映し，再描写の必要な領域を記録する
+    void ProcessRequests()
+    {
+        Request request;
+        while( TryPop( request ) ){
+            Apply( request );
+        }
+
+        uint64_t pending = s_PendingDraw.exchange( 0, std::memory_order_acquire );
+        while( pending ){
+            const LayerID id = __builtin_ctzll( pending );
+            pending &= pending - 1;
+            g_LayerManager->Draw( id );
+        }
+
+        if( s_Overflow.exchange( false, std::memory_order_acquire ) ){
+            g_LayerManager->Invalidate( {{0, 0}, g_ScreenSize} );
+        }
+    }
+}
+
+void Initialize()
+{
+    InterruptGuard guard;
+
+    Task& task = TaskManager::Instance()
+        .NewTask()
+        .InitContext( TaskCompositor, 0 );
+    s_Task = &task;
+    TaskManager::Instance().Wakeup( &task, k_TaskLevel );
+}
+
+uint64_t TaskID()
+{
+    return s_Task ? s_Task->ID() : 0;
+}
+
+void Submit( const Request& request )
+{
+    if( OnCompositorTask() ){
+        Apply( request );
+        return;
+    }
+
+    while( !TryPush( request ) ){
+        if( IsDamageOnly( request.Op ) ){
+            s_Overflow.store( true, std::memory_order_release );
+            return;
+        }
+
+        // 合成タスクにキューを空けてもらう
+        InterruptGuard guard;
+        if( s_Task ){
+            TaskManager::Instance().Wakeup( s_Task );
+        }
+        TaskManager::Instance().SwitchTask();
+    }
+}
+
+void Draw( LayerID id )
+{
+    if( id < k_PendingDrawLayers && !OnCompositorTask() ){
+        const uint64_t bit = 1ull << id;
+        s_PendingDraw.fetch_or( bit, std::memory_order_release );
+        return;
+    }
+    Submit( {Operation::Draw, id, 0, 0, 0, 0} );
+}
+
+void Draw( LayerID id, const RectAngle<int>& area )
+{
+    Submit( {Operation::DrawArea, id, area.pos.x, area.pos.y, area.size.x, area.size.y} );
+}
+
+void Move( LayerID id, Vector2<int> pos )
+{
+    Submit( {Operation::Move, id, pos.x, pos.y, 0, 0} );
+}
+
+void MoveRelative( LayerID id, Vector2<int> pos_diff )
+{
+    Submit( {Operation::MoveRelative, id, pos_diff.x, pos_diff.y, 0, 0} );
+}
+
+void Activate( LayerID id )
+{
+    Submit( {Operation::Activate, id, 0, 0, 0, 0} );
+}
+
+void TaskCompositor( uint64_t task_id, int64_t data )
+{
+    Task& task = TaskManager::Instance().CurrentTask();
+
+    ProcessRequests();
+    g_LayerManager->Flush();
+    {
+        InterruptGuard guard;
+        TimerManager::Instance().AddTimer( Timer(k_FramePeriod, k_FrameTimerValue, task.ID()) );
+    }
+
+    while(1){
+        // 反映だけはこまめに行い，画面への転送はフレームタイマでまとめて行う
+        ProcessRequests();
+
+        InterruptGuard guard;
+        auto msg = task.ReceiveMessage();
+        if( !msg ){
+            task.Sleep();
+            continue;
+        }
+        guard.Release();
+
+        switch( msg->Type ){
+        case Message::k_TimerTimeout:
+            if( msg->Arg.Timer.Value == k_FrameTimerValue ){
+                // マウス入力は 1 フレーム分をまとめて反映する
+                ApplyMouseInput();
+                gfxstat::UpdateHud();
+                ProcessRequests();
+                g_LayerManager->Flush();
+                InterruptGuard timer_guard;
+                TimerManager::Instance().AddTimer( Timer(k_FramePeriod, k_FrameTimerValue, task.ID()) );
+            }
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+}
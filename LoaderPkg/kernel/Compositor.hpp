@@ -0,0 +1,78 @@
+#pragma once
+
+//
+// include headers
+//
+#include <cstdint>
+
+#include "Type.hpp"
+#include "Graphic.hpp"
+#include "Timer.hpp"
+#include "Task.hpp"
+
+/**
+ * @brief 画面を専有して合成を行う合成タスク
+ *        LayerManager の操作と画面への転送は合成タスクだけが行い，
+ *        他のタスクはロック不要の要求キューに再描写・移動を登録して処理を続ける
+ *        登録された要求は 1 フレームごとにまとめて反映し，画面へは 1 回だけ転送する
+ */
+namespace compositor
+{
+//
+// constants
+//
+//! @brief 合成タスクの実行レベル (メインタスクと同じで，ワーカータスクより下)
+constexpr int k_TaskLevel = TaskManager::k_MainTaskLevel;
+//! @brief 1 フレームのタイマ tick 数 (k_TimerFreq が 100Hz なので 2tick = 50fps)
+constexpr int k_FramePeriod = k_TimerFreq / 50;
+
+//! @brief 合成タスクへの要求の種類
+enum class Operation : uint8_t
+{
+    Draw,           // レイヤー全体を再描写
+    DrawArea,       // レイヤーの一部 (レイヤー左上基準) を再描写
+    Move,           // レイヤーを絶対座標へ移動
+    MoveRelative,   // レイヤーを相対移動
+    Activate,       // レイヤーをアクティブにして最前面へ
+};
+
+struct Request
+{
+    Operation Op;
+    LayerID Layer;
+    int x, y;
+    int w, h;
+};
+
+//
+// functions
+//
+/**
+ * @brief 合成タスクを生成する。タスク管理とレイヤーの初期化後に呼ぶこと
+ *        それまでに登録された要求は合成タスクの開始時にまとめて反映する
+ */
+void Initialize();
+//! @brief 合成タスクの ID (生成前は 0)
+uint64_t TaskID();
+
+/**
+ * @brief 要求を登録する。合成タスク自身から呼ばれた場合はその場で反映する
+ *        再描写の要求はキューが一杯なら画面全体の再描写にまとめ，待たずに戻る
+ *        移動・アクティブ化の要求は失われると困るので，空きができるまで合成タスクに譲る
+ */
+void Submit( const Request& request );
+
+//! @brief レイヤー全体の再描写を要求する。反映前の同じ要求は 1 つにまとめる
+void Draw( LayerID id );
+//! @brief レイヤーの area (レイヤー左上基準) の再描写を要求する
+void Draw( LayerID id, const RectAngle<int>& area );
+//! @brief レイヤーの絶対座標への移動を要求する
+void Move( LayerID id, Vector2<int> pos );
+//! @brief レイヤーの相対移動を要求する
+void MoveRelative( LayerID id, Vector2<int> pos_diff );
+//! @brief レイヤーのアクティブ化を要求する
+void Activate( LayerID id );
+
+void TaskCompositor( uint64_t task_id, int64_t data );
+
+}
@@ -3,6 +3,7 @@
 #include "Console.hpp"
 #include "Global.hpp"
 #include "Font.hpp"
+#include "Compositor.hpp"
 
 Console::Console( const PixelColor& fg_color, const PixelColor& bg_color )
     : m_Window( nullptr ),
@@ -11,10 +12,11 @@ Console::Console( const PixelColor& fg_color, const PixelColor& bg_color )
       m_BackGroundColor( bg_color ),
       m_CursorRow( 0 ),
       m_CursorColumn( 0 ),
+      m_Scrolled( false ),
       m_Buffer{},
       m_ConsoleLines()
 {
-    m_ConsoleLines.Push( m_Buffer[m_CursorRow] );
+    m_ConsoleLines.Push( m_Buffer[0] );
 }
 
 void Console::SetWindow( std::shared_ptr<Window> window )
@@ -40,32 +42,36 @@ unsigned int Console::LayerID() const
       
 void Console::PutString( const char* s )
 {
-    char* curr_line = CurrentLine();
+    const int start_row = m_CursorRow;
+    m_Scrolled = false;
+
     while( *s ){
         if( *s == '\n' ){
             NewLine();
         }
         else if( m_CursorColumn < sk_Columns ){
-            WriteAscii( *m_Window->Writer(), 8 * m_CursorColumn, 16 * m_CursorRow, *s, m_ForeGroundColor );
-            curr_line[m_CursorColumn] = *s;
+            WriteAscii( *m_Window->Writer(), 8 * m_CursorColumn, 16 * m_CursorRow, *s, m_ForeGroundColor, m_BackGroundColor );
+            CurrentLine()[m_CursorColumn] = *s;
             ++m_CursorColumn;
         }
         ++s;
     }
 
     if( g_LayerManager ){
-        g_LayerManager->Draw( m_LayerID );
+        if( m_Scrolled ){
+            compositor::Draw( m_LayerID );
+        }
+        else {
+            // 書き込んだ行だけ再描写する
+            compositor::Draw( m_LayerID, {{0, 16 * start_row}, {8 * sk_Columns, 16 * (m_CursorRow - start_row + 1)}} );
+        }
     }
 }
 
 void Console::ClearConsole()
 {
-    for( int y = 0; y < 16 * sk_Rows; ++y ){
-        for( int x = 0; x < 8 * sk_Columns; ++x ){
-            m_Window->Writer()->Write( x, y, m_BackGroundColor );
-        }
-    }
-    g_LayerManager->Draw( m_LayerID );
+    m_Window->Writer()->FillRect( 0, 0, 8 * sk_Columns, 16 * sk_Rows, m_BackGroundColor );
+    compositor::Draw( m_LayerID );
 }
 
 char* Console::CurrentLine()
@@ -77,30 +83,47 @@ void Console::NewLine()
 {
     m_CursorColumn = 0;
 
+    // 保持行数を超えたら一番古い行を再利用する
+    char* line = nullptr;
+    if( m_ConsoleLines.Size() < sk_ScrollbackLines ){
+        line = m_Buffer[m_ConsoleLines.Size()];
+    }
+    else {
+        line = m_ConsoleLines.Front();
+        m_ConsoleLines.Pop();
+    }
+    memset( line, 0, sk_ColumnBufferLen );
+    m_ConsoleLines.Push( line );
+
     if( m_CursorRow < (sk_Rows - 1) ){
         ++m_CursorRow;
-        m_ConsoleLines.Push( m_Buffer[m_CursorRow] );
     }
     else {
-        // コンソールクリア
-        ClearConsole();
-        // 一番最初の行を取り出し、最後尾に追加する
-        char* line = m_ConsoleLines.Front();
-        m_ConsoleLines.Pop();
-        memset( line, 0, sk_ColumnBufferLen );
-        m_ConsoleLines.Push( line );
-        // コンソール再描写
-        Refresh();
+        ScrollLine();
     }
 }
 
+void Console::ScrollLine()
+{
+    RectAngle<int> move_src{ {0, 16}, {8 * sk_Columns, 16 * (sk_Rows - 1)} };
+    m_Window->Move( {0, 0}, move_src );
+    m_Window->Writer()->FillRect( 0, 16 * (sk_Rows - 1), 8 * sk_Columns, 16, m_BackGroundColor );
+    m_Scrolled = true;
+}
+
 void Console::Refresh()
 {
-    std::size_t size = m_ConsoleLines.Size();
-    for( int row = 0; row < size; ++row ){
-        const char* line = m_ConsoleLines[row];
-        WriteString( *m_Window->Writer(), 0, 16 * row, line, m_ForeGroundColor );
+    // 保持している行のうち最後の sk_Rows 行を表示する
+    const std::size_t size = m_ConsoleLines.Size();
+    const std::size_t first = size > sk_Rows ? size - sk_Rows : 0;
+    for( std::size_t i = first; i < size; ++i ){
+        const char* line = m_ConsoleLines[i];
+        const int row = static_cast<int>(i - first);
+        m_Window->Writer()->FillRect( 0, 16 * row, 8 * sk_Columns, 16, m_BackGroundColor );
+        WriteString( *m_Window->Writer(), 0, 16 * row, line, m_ForeGroundColor, m_BackGroundColor );
     }
 
-    g_LayerManager->Draw( m_LayerID );
+    if( g_LayerManager ){
+        compositor::Draw( m_LayerID );
+    }
 }
\ No newline at end of file
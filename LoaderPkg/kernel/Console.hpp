@@ -11,6 +11,8 @@ public:
 
     static constexpr int sk_Rows    = 25;
     static constexpr int sk_Columns = 80;
+    //! 保持しておく行数 (表示されるのは最後の sk_Rows 行)
+    static constexpr int sk_ScrollbackLines = 256;
     
     Console( const PixelColor& fg_color, const PixelColor& bg_color );
     ~Console() = default;
@@ -29,6 +31,8 @@ private:
 
     char* CurrentLine();
     void NewLine();
+    //! @brief 表示内容を1行分上にずらし，最下行を消去する
+    void ScrollLine();
     void Refresh();
 
     std::shared_ptr<Window> m_Window;
@@ -38,6 +42,8 @@ private:
 
     int m_CursorRow;
     int m_CursorColumn;
-    char m_Buffer[sk_Rows][sk_ColumnBufferLen];
-    RingBuffer<char*, sk_Rows> m_ConsoleLines;
+    //! PutString 中にスクロールしたか (再描写範囲の決定に使う)
+    bool m_Scrolled;
+    char m_Buffer[sk_ScrollbackLines][sk_ColumnBufferLen];
+    RingBuffer<char*, sk_ScrollbackLines> m_ConsoleLines;
 };
@@ -1,12 +1,134 @@
 #include <cstdint>
+#include <cstring>
+#include <algorithm>
 #include "Font.hpp"
 #include "PixelWriter.hpp"
+#include "InterruptGuard.hpp"
 
 
 extern const uint8_t _binary_hankaku_font_bin_start[];
 extern const uint8_t _binary_hankaku_font_bin_end[];
 extern const uint8_t _binary_hankaku_font_bin_size[];
 
+//
+// constant
+//
+namespace
+{
+    constexpr int k_GlyphWidth  = 8;
+    constexpr int k_GlyphHeight = 16;
+    //! グリフキャッシュのエントリ数 (1エントリ 512byte)
+    constexpr int k_GlyphCacheEntries = 256;
+    //! WriteString が1回の Blit で描く最大文字数 (並べるバッファはタスクのスタックに置くので小さくする)
+    constexpr int k_LineBatchChars = 2;
+}
+
+//
+// static variables
+//
+namespace
+{
+    //! @brief 前景色・背景色を展開済みのネイティブ形式のグリフ画像
+    struct GlyphTile
+    {
+        bool        Valid;
+        bool        Opaque;     // false なら背景は透過色 (~Fg)
+        char        Char;
+        PixelFormat Format;
+        uint32_t    Fg;
+        uint32_t    Bg;
+        uint32_t    Pixels[k_GlyphHeight][k_GlyphWidth];
+    };
+
+    // 複数のタスクから使われるので，参照・更新は割り込み禁止中に行う
+    GlyphTile s_GlyphCache[k_GlyphCacheEntries];
+}
+
+//
+// static function declaration
+//
+namespace
+{
+    const GlyphTile& LookupGlyph( char c, PixelFormat format, uint32_t fg, uint32_t bg, bool opaque );
+    void DrawString( IPixelWriter& writer, int x, int y, const char* s,
+                     const PixelColor& color, const PixelColor* bg_color );
+}
+
+//
+// funcion definitions
+//
+namespace
+{
+    //! @brief キャッシュからグリフを探し，無ければ展開して登録する。割り込み禁止中に呼ぶこと
+    const GlyphTile& LookupGlyph( char c, PixelFormat format, uint32_t fg, uint32_t bg, bool opaque )
+    {
+        const uint32_t hash = (fg * 0x9E3779B1u) ^ (bg * 0x85EBCA6Bu);
+        const uint32_t index = (static_cast<uint8_t>(c) ^ (hash >> 24) ^ (opaque ? 0x80 : 0)) % k_GlyphCacheEntries;
+
+        GlyphTile& tile = s_GlyphCache[index];
+        if( tile.Valid && tile.Char == c && tile.Format == format &&
+            tile.Fg == fg && tile.Bg == bg && tile.Opaque == opaque )
+        {
+            return tile;
+        }
+
+        const uint8_t* font = GetFont( c );
+        for( int dy = 0; dy < k_GlyphHeight; ++dy ){
+            const uint8_t bits = font ? font[dy] : 0;
+            for( int dx = 0; dx < k_GlyphWidth; ++dx ){
+                tile.Pixels[dy][dx] = (bits & (0x80u >> dx)) ? fg : bg;
+            }
+        }
+        tile.Valid  = true;
+        tile.Opaque = opaque;
+        tile.Char   = c;
+        tile.Format = format;
+        tile.Fg     = fg;
+        tile.Bg     = bg;
+
+        return tile;
+    }
+
+    //! @brief bg_color が nullptr なら背景を透過して描く
+    void DrawString( IPixelWriter& writer, int x, int y, const char* s,
+                     const PixelColor& color, const PixelColor* bg_color )
+    {
+        const auto format = writer.Format();
+        const uint32_t fg = PackPixel( format, color );
+        const bool opaque = (bg_color != nullptr);
+        // 透過する場合は前景色と必ず異なる値を透過色にする
+        const uint32_t bg = opaque ? PackPixel( format, *bg_color ) : ~fg;
+        constexpr int k_Stride = k_LineBatchChars * k_GlyphWidth;
+
+        std::size_t len = strlen( s );
+        while( len > 0 ){
+            const int n = static_cast<int>( std::min<std::size_t>( len, k_LineBatchChars ) );
+
+            // キャッシュから自分のバッファへグリフを並べるまでを割り込み禁止にし，描画は許可してから行う
+            uint32_t line[k_GlyphHeight][k_Stride];
+            InterruptGuard guard;
+            for( int i = 0; i < n; ++i ){
+                const auto& tile = LookupGlyph( s[i], format, fg, bg, opaque );
+                for( int dy = 0; dy < k_GlyphHeight; ++dy ){
+                    memcpy( &line[dy][k_GlyphWidth * i], tile.Pixels[dy], sizeof(tile.Pixels[dy]) );
+                }
+            }
+            guard.Release();
+
+            if( opaque ){
+                writer.Blit( x, y, &line[0][0], k_Stride, k_GlyphWidth * n, k_GlyphHeight );
+            }
+            else {
+                writer.BlitTransparent( x, y, &line[0][0], k_Stride, k_GlyphWidth * n, k_GlyphHeight, bg );
+            }
+
+            s   += n;
+            len -= n;
+            x   += k_GlyphWidth * n;
+        }
+    }
+}
+
 const uint8_t* GetFont( char c )
 {
     uint32_t index = 16 * static_cast<uint32_t>( c );
@@ -19,23 +141,28 @@ const uint8_t* GetFont( char c )
 
 void WriteAscii( IPixelWriter& writer, int x, int y, char c, const PixelColor& color )
 {
-    const uint8_t* font = GetFont( c );
-    if( font == nullptr ){
+    const char s[2] = { c, '\0' };
+    if( c == '\0' ){
         return;
     }
+    DrawString( writer, x, y, s, color, nullptr );
+}
 
-    for( int dy = 0; dy < 16; ++dy ){
-        for( int dx = 0; dx < 8; ++dx ){
-            if( font[dy] & (static_cast<uint32_t>(0x80) >> dx) ){
-                writer.Write( x + dx, y + dy, color );
-            }
-        }
+void WriteAscii( IPixelWriter& writer, int x, int y, char c, const PixelColor& color, const PixelColor& bg_color )
+{
+    const char s[2] = { c, '\0' };
+    if( c == '\0' ){
+        return;
     }
+    DrawString( writer, x, y, s, color, &bg_color );
 }
 
 void WriteString( IPixelWriter& writer, int x, int y, const char* s, const PixelColor& color )
 {
-    for( int i = 0; s[i] != '\0'; ++i ){
-        WriteAscii( writer, x + 8 * i, y, s[i], color );
-    }
-}
\ No newline at end of file
+    DrawString( writer, x, y, s, color, nullptr );
+}
+
+void WriteString( IPixelWriter& writer, int x, int y, const char* s, const PixelColor& color, const PixelColor& bg_color )
+{
+    DrawString( writer, x, y, s, color, &bg_color );
+}
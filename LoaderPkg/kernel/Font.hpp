@@ -4,5 +4,11 @@
 
 const uint8_t* GetFont( char c );
 
+//! @brief 1文字描く。背景は透過する
 void WriteAscii( IPixelWriter& writer, int x, int y, char c, const PixelColor& color );
-void WriteString( IPixelWriter& writer, int x, int y, const char* s, const PixelColor& color );
\ No newline at end of file
+//! @brief 1文字描く。背景を bg_color で塗る
+void WriteAscii( IPixelWriter& writer, int x, int y, char c, const PixelColor& color, const PixelColor& bg_color );
+//! @brief 文字列を描く。背景は透過する
+void WriteString( IPixelWriter& writer, int x, int y, const char* s, const PixelColor& color );
+//! @brief 文字列を描く。背景を bg_color で塗る
+void WriteString( IPixelWriter& writer, int x, int y, const char* s, const PixelColor& color, const PixelColor& bg_color );
@@ -2,12 +2,20 @@
 // include files
 //
 #include "FrameBuffer.hpp"
+
+#include <cstring>
+
 #include "Graphic.hpp"
+#include "BlitKernel.hpp"
 
 
 //
 // constant
 //
+namespace {
+    //! 自前で確保するバッファの1ラインあたりのピクセル数はこの倍数に揃える(16byte境界)
+    constexpr uint32_t k_StrideAlignPixels = 4;
+}
 
 //
 // static variables
@@ -19,9 +27,9 @@
 namespace {
     int BitsPerPixel( PixelFormat format );
     int BytesPerPixel( PixelFormat format );
-    uint8_t* FrameAddrAt( Vector2<int> pos, const FrameBufferConfig& config );
-    int BytesPerScanLine( const FrameBufferConfig& config );
     Vector2<int> FrameBufferSize( const FrameBufferConfig& config );
+    RectAngle<int> CopyArea( Vector2<int> dst_pos, const FrameBufferConfig& dst,
+                             const FrameBufferConfig& src, const RectAngle<int>& src_area );
 }
 //
 // funcion definitions
@@ -55,27 +63,28 @@ namespace {
         return -1;
     }
 
-    uint8_t* FrameAddrAt( Vector2<int> pos, const FrameBufferConfig& config ) 
+    Vector2<int> FrameBufferSize( const FrameBufferConfig& config ) 
     {
-        return config.FrameBuffer + BytesPerPixel(config.PixelFormat) *
-        (config.PixelsPerScanLine * pos.y + pos.x);
+        return {static_cast<int>(config.HorizontalResolution),
+                static_cast<int>(config.VerticalResolution)};
     }
 
-    int BytesPerScanLine( const FrameBufferConfig& config ) 
+    //! @brief コピー先座標系でのコピー領域(コピー先・コピー元の双方でクリップ済み)を求める
+    RectAngle<int> CopyArea( Vector2<int> dst_pos, const FrameBufferConfig& dst,
+                             const FrameBufferConfig& src, const RectAngle<int>& src_area )
     {
-        return BytesPerPixel(config.PixelFormat) * config.PixelsPerScanLine;
-    }
+        const RectAngle<int> dst_outline( {0, 0}, FrameBufferSize(dst) );
+        const RectAngle<int> src_area_shifted( dst_pos, src_area.size );
+        const RectAngle<int> src_outline( dst_pos - src_area.pos, FrameBufferSize(src) );
 
-    Vector2<int> FrameBufferSize( const FrameBufferConfig& config ) 
-    {
-        return {static_cast<int>(config.HorizontalResolution),
-                static_cast<int>(config.VerticalResolution)};
+        return dst_outline.Intersection( src_outline.Intersection( src_area_shifted ) );
     }
 }
 
 Error FrameBuffer::Initialize( const FrameBufferConfig& config )
 {
     m_Config = config;
+    m_BytesPerPixel = 0;
 
     const auto bytes_per_pixel = BytesPerPixel( config.PixelFormat );
     if( bytes_per_pixel <= 0 ){
@@ -86,11 +95,12 @@ Error FrameBuffer::Initialize( const FrameBufferConfig& config )
         m_Buffer.resize(0);
     }
     else {
+        const uint32_t stride = (m_Config.HorizontalResolution + k_StrideAlignPixels - 1) & ~(k_StrideAlignPixels - 1);
         m_Buffer.resize(
-            bytes_per_pixel * m_Config.HorizontalResolution * m_Config.VerticalResolution
+            bytes_per_pixel * stride * m_Config.VerticalResolution
         );
         m_Config.FrameBuffer = m_Buffer.data();
-        m_Config.PixelsPerScanLine = m_Config.HorizontalResolution;
+        m_Config.PixelsPerScanLine = stride;
     }
 
     switch( m_Config.PixelFormat ){
@@ -103,6 +113,7 @@ Error FrameBuffer::Initialize( const FrameBufferConfig& config )
     default:
         return MAKE_ERROR( Error::kUnknownPixelFormat );
     }
+    m_BytesPerPixel = bytes_per_pixel;
 
     return MAKE_ERROR( Error::kSuccess );
 }
@@ -113,63 +124,118 @@ Error FrameBuffer::Copy( Vector2<int> dst_pos, const FrameBuffer& src, const Rec
         return MAKE_ERROR( Error::kUnknownPixelFormat );
     }
 
-    const auto bytes_per_pixel = BytesPerPixel( m_Config.PixelFormat );
-    if( bytes_per_pixel <= 0 ){
+    if( m_BytesPerPixel != 4 ){
+        return MAKE_ERROR( Error::kUnknownPixelFormat );
+    }
+
+    const auto copy_area = CopyArea( dst_pos, m_Config, src.m_Config, src_area );
+    const auto src_start_pos = copy_area.pos - (dst_pos - src_area.pos);
+    const bool stream = IsScreen();
+
+    for( int y = 0; y < copy_area.size.y; ++y ){
+        blit::CopyRow( &NativePixel( copy_area.pos.x, copy_area.pos.y + y ),
+                       &src.NativePixel( src_start_pos.x, src_start_pos.y + y ),
+                       copy_area.size.x, stream );
+    }
+    if( stream ){
+        blit::StoreFence();
+    }
+    CountWritten( copy_area );
+
+    return MAKE_ERROR( Error::kSuccess );
+}
+
+Error FrameBuffer::CopyTransparent( Vector2<int> dst_pos, const FrameBuffer& src, const RectAngle<int>& src_area, uint32_t key )
+{
+    if( m_Config.PixelFormat != src.m_Config.PixelFormat ){
+        return MAKE_ERROR( Error::kUnknownPixelFormat );
+    }
+    if( m_BytesPerPixel != 4 ){
         return MAKE_ERROR( Error::kUnknownPixelFormat );
     }
 
-    const RectAngle<int> dst_outline( {0, 0}, FrameBufferSize(m_Config) );
-    const RectAngle<int> src_area_shifted( dst_pos, src_area.size );
-    const RectAngle<int> src_outline( dst_pos - src_area.pos, FrameBufferSize(src.m_Config) );
+    const auto copy_area = CopyArea( dst_pos, m_Config, src.m_Config, src_area );
+    const auto src_start_pos = copy_area.pos - (dst_pos - src_area.pos);
+
+    for( int y = 0; y < copy_area.size.y; ++y ){
+        blit::CopyRowKeyed( &NativePixel( copy_area.pos.x, copy_area.pos.y + y ),
+                            &src.NativePixel( src_start_pos.x, src_start_pos.y + y ),
+                            copy_area.size.x, key );
+    }
+    CountWritten( copy_area );
 
-    const auto copy_area = dst_outline.Intersection( src_outline.Intersection( src_area_shifted ) );
+    return MAKE_ERROR( Error::kSuccess );
+}
+
+Error FrameBuffer::CopyBlend( Vector2<int> dst_pos, const FrameBuffer& src, const RectAngle<int>& src_area )
+{
+    if( m_Config.PixelFormat != src.m_Config.PixelFormat ){
+        return MAKE_ERROR( Error::kUnknownPixelFormat );
+    }
+    if( m_BytesPerPixel != 4 ){
+        return MAKE_ERROR( Error::kUnknownPixelFormat );
+    }
+
+    const auto copy_area = CopyArea( dst_pos, m_Config, src.m_Config, src_area );
     const auto src_start_pos = copy_area.pos - (dst_pos - src_area.pos);
- 
-    uint8_t* dst_buf = FrameAddrAt( copy_area.pos, m_Config );
-    const uint8_t* src_buf = FrameAddrAt( src_start_pos, src.m_Config );
 
     for( int y = 0; y < copy_area.size.y; ++y ){
-        memcpy( dst_buf, src_buf, bytes_per_pixel * copy_area.size.x );
-        dst_buf += BytesPerScanLine( m_Config );
-        src_buf += BytesPerScanLine( src.m_Config );
+        blit::BlendRowOver( &NativePixel( copy_area.pos.x, copy_area.pos.y + y ),
+                            &src.NativePixel( src_start_pos.x, src_start_pos.y + y ),
+                            copy_area.size.x );
     }
+    CountWritten( copy_area );
 
     return MAKE_ERROR( Error::kSuccess );
 }
 
 void FrameBuffer::Move(Vector2<int> dst_pos, const RectAngle<int> &src)
 {
-    const auto bytes_per_pixel = BytesPerPixel(m_Config.PixelFormat);
-    const auto bytes_per_scan_line = BytesPerScanLine(m_Config);
+    const bool stream = IsScreen();
 
     if (dst_pos.y < src.pos.y){ // move up
-        uint8_t *dst_buf = FrameAddrAt(dst_pos, m_Config);
-        const uint8_t *src_buf = FrameAddrAt(src.pos, m_Config);
         for (int y = 0; y < src.size.y; ++y){
-            memcpy(dst_buf, src_buf, bytes_per_pixel * src.size.x);
-            dst_buf += bytes_per_scan_line;
-            src_buf += bytes_per_scan_line;
+            blit::CopyRow(&NativePixel(dst_pos.x, dst_pos.y + y),
+                          &NativePixel(src.pos.x, src.pos.y + y), src.size.x, stream);
         }
     }
     else if (dst_pos.y == src.pos.y){ // move left or move right
-        uint8_t *dst_buf = FrameAddrAt(dst_pos, m_Config);
-        const uint8_t *src_buf = FrameAddrAt(src.pos, m_Config);
         for (int y = 0; y < src.size.y; ++y){
             // dst_buf and src_buf may overlap, we must use memmove
-            memmove(dst_buf, src_buf, bytes_per_pixel * src.size.x);
-            dst_buf += bytes_per_scan_line;
-            src_buf += bytes_per_scan_line;
+            memmove(&NativePixel(dst_pos.x, dst_pos.y + y),
+                    &NativePixel(src.pos.x, src.pos.y + y), m_BytesPerPixel * src.size.x);
         }
     }
     else { // move down
-        uint8_t *dst_buf = FrameAddrAt(dst_pos + Vector2<int>{0, src.size.y - 1}, m_Config);
-        const uint8_t *src_buf = FrameAddrAt(src.pos + Vector2<int>{0, src.size.y - 1}, m_Config);
-        for (int y = 0; y < src.size.y; ++y){
-            memcpy(dst_buf, src_buf, bytes_per_pixel * src.size.x);
-            dst_buf -= bytes_per_scan_line;
-            src_buf -= bytes_per_scan_line;
+        for (int y = src.size.y - 1; y >= 0; --y){
+            blit::CopyRow(&NativePixel(dst_pos.x, dst_pos.y + y),
+                          &NativePixel(src.pos.x, src.pos.y + y), src.size.x, stream);
         }
     }
+    if (stream){
+        blit::StoreFence();
+    }
+    CountWritten({dst_pos, src.size});
+}
+
+void FrameBuffer::Fill( const RectAngle<int>& area, const PixelColor& c )
+{
+    Fill( area, PackPixel( m_Config.PixelFormat, c ) );
+}
+
+void FrameBuffer::Fill( const RectAngle<int>& area, uint32_t value )
+{
+    const RectAngle<int> outline( {0, 0}, FrameBufferSize(m_Config) );
+    const auto fill_area = outline.Intersection( area );
+    const bool stream = IsScreen();
+
+    for( int y = 0; y < fill_area.size.y; ++y ){
+        blit::FillRow( &NativePixel( fill_area.pos.x, fill_area.pos.y + y ), value, fill_area.size.x, stream );
+    }
+    if( stream ){
+        blit::StoreFence();
+    }
+    CountWritten( fill_area );
 }
 
 FrameBufferPixelWriter& FrameBuffer::Writer()
@@ -181,3 +247,10 @@ const FrameBufferConfig& FrameBuffer::Config() const
 {
     return m_Config;
 }
+
+void FrameBuffer::CountWritten( const RectAngle<int>& area )
+{
+    if( area.size.x > 0 && area.size.y > 0 ){
+        m_WrittenBytes += static_cast<uint64_t>(area.size.x) * area.size.y * m_BytesPerPixel;
+    }
+}
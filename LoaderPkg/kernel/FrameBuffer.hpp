@@ -28,17 +28,59 @@ public:
      * @param [in] area コピー元バッファの左上を基準とするコピー領域
      */
     Error Copy( Vector2<int> dst_pos, const FrameBuffer& src, const RectAngle<int>& src_area );
+    /**
+     * @brief 透過色を除いてデータコピー
+     * @param [in] pos コピー先位置
+     * @param [in] src コピー元バッファ
+     * @param [in] area コピー元バッファの左上を基準とするコピー領域
+     * @param [in] key  透過色(ネイティブ形式) この値のピクセルはコピーしない
+     */
+    Error CopyTransparent( Vector2<int> dst_pos, const FrameBuffer& src, const RectAngle<int>& src_area, uint32_t key );
+    /**
+     * @brief α 乗算済みのピクセルを持つ src を重ねる
+     * @param [in] pos コピー先位置
+     * @param [in] src コピー元バッファ (上位 8bit が透明度)
+     * @param [in] area コピー元バッファの左上を基準とするコピー領域
+     */
+    Error CopyBlend( Vector2<int> dst_pos, const FrameBuffer& src, const RectAngle<int>& src_area );
 
     void Move( Vector2<int> dst_pos, const RectAngle<int>& src );
+    //! @brief 矩形領域を指定色で塗りつぶす(バッファ外はクリップする)
+    void Fill( const RectAngle<int>& area, const PixelColor& c );
+    //! @brief 矩形領域をネイティブ形式の値で塗りつぶす(バッファ外はクリップする)
+    void Fill( const RectAngle<int>& area, uint32_t value );
 
     FrameBufferPixelWriter& Writer();
     const FrameBufferConfig& Config() const;
+    //! @brief Copy / Fill / Move などでこのバッファへ書き込んだバイト数の累計
+    uint64_t WrittenBytes() const { return m_WrittenBytes; }
+
+    /**
+     * @brief 指定位置のピクセルをネイティブ形式(32bit)で参照する
+     *        範囲チェックは行わないので呼び出し側で保証すること
+     */
+    uint32_t& NativePixel( int x, int y )
+    {
+        return reinterpret_cast<uint32_t*>(m_Config.FrameBuffer)[m_Config.PixelsPerScanLine * y + x];
+    }
+    const uint32_t& NativePixel( int x, int y ) const
+    {
+        return reinterpret_cast<const uint32_t*>(m_Config.FrameBuffer)[m_Config.PixelsPerScanLine * y + x];
+    }
 
 private:
 
+    //! @brief VRAM を直接指している(自前のバッファを持たない)か
+    bool IsScreen() const { return m_Buffer.empty(); }
+    //! @brief area への書き込みを m_WrittenBytes に数える
+    void CountWritten( const RectAngle<int>& area );
+
     FrameBufferConfig    m_Config;
+    //! Initialize 時に決定した1ピクセルあたりのバイト数
+    int                  m_BytesPerPixel = 0;
     std::vector<uint8_t> m_Buffer;
     std::unique_ptr<FrameBufferPixelWriter> m_Writer;
+    uint64_t             m_WrittenBytes = 0;
 };
 
 //int BitsPerPixel( PixelFormat format );
@@ -0,0 +1,201 @@
+//
+// include files
+//
+#include "GfxStat.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <limits>
+
+#include "Global.hpp"
+#include "Font.hpp"
+#include "Timer.hpp"
+#include "InterruptGuard.hpp"
+
+namespace gfxstat
+{
+//
+// constant
+//
+namespace
+{
+    //! オーバーレイの表示行数・桁数
+    constexpr int k_HudRows    = 4;
+    constexpr int k_HudColumns = 24;
+    constexpr int k_HudMargin  = 4;
+    constexpr Vector2<int> k_HudSize{ k_HudColumns * 8 + k_HudMargin * 2, k_HudRows * 16 + k_HudMargin * 2 };
+    //! オーバーレイの背景の不透明度
+    constexpr uint8_t k_HudBackgroundAlpha = 160;
+    //! オーバーレイの表示内容を更新する間隔
+    constexpr uint64_t k_HudRefreshTicks = k_TimerFreq / 2;
+}
+
+//
+// static variables
+//
+namespace
+{
+    // 記録・参照は割り込み禁止中に行う
+    uint64_t s_Frames;
+    FrameStats s_Last;
+    FrameStats s_Total;
+    //! 直近のフレームの合成時間 (リングバッファ)
+    uint32_t s_History[k_FrameHistory];
+
+    std::atomic<bool> s_HudRequested;
+    // 以下は合成タスクのみが参照する
+    bool s_HudShown;
+    LayerID s_HudLayer;
+    std::shared_ptr<Window> s_HudWindow;
+    uint64_t s_HudNextTick;
+}
+
+//
+// static function declaration
+//
+namespace
+{
+    void ShowHud();
+    void DrawHud();
+}
+
+//
+// funcion definitions
+//
+namespace
+{
+    void ShowHud()
+    {
+        if( s_HudLayer == 0 ){
+            s_HudWindow = std::make_shared<Window>( k_HudSize.x, k_HudSize.y, g_MainScreen.Config().PixelFormat );
+            s_HudWindow->SetAlphaBlending( true );
+            s_HudLayer = g_LayerManager->NewLayer()
+                .SetWindow( s_HudWindow )
+                .Move( {g_ScreenSize.x - k_HudSize.x - 8, 8} )
+                .ID();
+        }
+        g_LayerManager->UpDown( s_HudLayer, std::numeric_limits<int>::max() );
+        s_HudNextTick = 0;
+    }
+
+    void DrawHud()
+    {
+        Summary summary;
+        GetSummary( summary );
+
+        const uint64_t frames = std::max<uint64_t>( summary.Frames, 1 );
+        char lines[k_HudRows][k_HudColumns + 8];
+        snprintf( lines[0], sizeof(lines[0]), "p50 %5luus p99 %5luus",
+                  CyclesToMicroSeconds( summary.P50Cycles ), CyclesToMicroSeconds( summary.P99Cycles ) );
+        snprintf( lines[1], sizeof(lines[1]), "max %5luus  %8lu f",
+                  CyclesToMicroSeconds( summary.MaxCycles ), summary.Frames );
+        snprintf( lines[2], sizeof(lines[2]), "px/f %8lu draw %4lu",
+                  summary.Total.PixelsComposited / frames, summary.Total.DrawCalls / frames );
+        snprintf( lines[3], sizeof(lines[3]), "KB/f %8lu lyr  %4lu",
+                  summary.Total.BytesToScreen / frames / 1024, summary.Total.LayersVisited / frames );
+
+        s_HudWindow->FillRect( {0, 0}, k_HudSize, {0, 0, 0}, k_HudBackgroundAlpha );
+        auto writer = s_HudWindow->Writer();
+        for( int i = 0; i < k_HudRows; ++i ){
+            WriteString( *writer, k_HudMargin, k_HudMargin + 16 * i, lines[i], {255, 255, 255} );
+        }
+
+        // 後から作られたウィンドウに隠されないよう，更新のたびに最前面へ戻す
+        g_LayerManager->UpDown( s_HudLayer, std::numeric_limits<int>::max() );
+        g_LayerManager->Draw( s_HudLayer );
+    }
+}
+
+void RecordFrame( const FrameStats& frame )
+{
+    InterruptGuard guard;
+
+    s_History[s_Frames % k_FrameHistory] =
+        static_cast<uint32_t>( std::min<uint64_t>( frame.Cycles, std::numeric_limits<uint32_t>::max() ) );
+    ++s_Frames;
+
+    s_Last = frame;
+    s_Total.Cycles           += frame.Cycles;
+    s_Total.PixelsComposited += frame.PixelsComposited;
+    s_Total.BytesToScreen    += frame.BytesToScreen;
+    s_Total.DrawCalls        += frame.DrawCalls;
+    s_Total.LayersVisited    += frame.LayersVisited;
+    s_Total.DamageRects      += frame.DamageRects;
+}
+
+void GetSummary( Summary& summary )
+{
+    uint32_t history[k_FrameHistory];
+
+    InterruptGuard guard;
+    summary.Frames = s_Frames;
+    summary.Last   = s_Last;
+    summary.Total  = s_Total;
+    const std::size_t n = std::min<uint64_t>( s_Frames, k_FrameHistory );
+    std::copy( s_History, s_History + n, history );
+    guard.Release();
+
+    if( n == 0 ){
+        summary.P50Cycles = summary.P90Cycles = summary.P99Cycles = summary.MaxCycles = 0;
+        return;
+    }
+
+    std::sort( history, history + n );
+    summary.P50Cycles = history[(n - 1) * 50 / 100];
+    summary.P90Cycles = history[(n - 1) * 90 / 100];
+    summary.P99Cycles = history[(n - 1) * 99 / 100];
+    summary.MaxCycles = history[n - 1];
+}
+
+void Reset()
+{
+    InterruptGuard guard;
+    s_Frames = 0;
+    s_Last   = FrameStats{};
+    s_Total  = FrameStats{};
+}
+
+void SetHudVisible( bool visible )
+{
+    s_HudRequested.store( visible, std::memory_order_relaxed );
+}
+
+bool IsHudVisible()
+{
+    return s_HudRequested.load( std::memory_order_relaxed );
+}
+
+LayerID HudLayerID()
+{
+    return s_HudLayer;
+}
+
+void UpdateHud()
+{
+    const bool visible = s_HudRequested.load( std::memory_order_relaxed );
+    if( visible != s_HudShown ){
+        if( visible ){
+            ShowHud();
+        }
+        else {
+            // 隠す前に，オーバーレイの下にあった部分を描き直すよう記録しておく
+            g_LayerManager->Draw( s_HudLayer );
+            g_LayerManager->Hide( s_HudLayer );
+        }
+        s_HudShown = visible;
+    }
+
+    if( !s_HudShown ){
+        return;
+    }
+
+    const uint64_t tick = TimerManager::Instance().CurrentTick();
+    if( tick < s_HudNextTick ){
+        return;
+    }
+    s_HudNextTick = tick + k_HudRefreshTicks;
+    DrawHud();
+}
+
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+//
+// include headers
+//
+#include <cstdint>
+#include <cstddef>
+
+#include "Type.hpp"
+
+/**
+ * @brief 画面合成の統計
+ *        LayerManager::Flush が 1 フレームごとに記録し，gfxstat コマンドとオーバーレイ表示で参照する
+ */
+namespace gfxstat
+{
+//
+// constants
+//
+//! @brief 合成時間の分位数を求めるために保持する直近のフレーム数
+constexpr std::size_t k_FrameHistory = 128;
+
+//
+// typedef structures
+//
+//! @brief 1 フレーム (再描写する領域があった LayerManager::Flush 1 回) の統計
+struct FrameStats
+{
+    uint64_t Cycles;            //! 合成と画面への転送にかかった TSC サイクル数
+    uint64_t PixelsComposited;  //! レイヤーからバックバッファへ描いたピクセル数
+    uint64_t BytesToScreen;     //! 前のフレームから画面へ書き込んだバイト数 (カーソルの移動を含む)
+    uint32_t DrawCalls;         //! Layer::DrawTo の呼び出し回数
+    uint32_t LayersVisited;     //! 見えている領域を求める際に調べたレイヤー数
+    uint32_t DamageRects;       //! 再描写した矩形数
+};
+
+struct Summary
+{
+    uint64_t Frames;            //! 記録したフレーム数
+    FrameStats Last;            //! 最後のフレーム
+    FrameStats Total;           //! 全フレームの合計
+    //! 直近 k_FrameHistory フレームの合成時間の分位数 (TSC サイクル)
+    uint64_t P50Cycles;
+    uint64_t P90Cycles;
+    uint64_t P99Cycles;
+    uint64_t MaxCycles;
+};
+
+//
+// functions
+//
+//! @brief 1 フレームの統計を記録する
+void RecordFrame( const FrameStats& frame );
+//! @brief 記録した統計をまとめて取得する
+void GetSummary( Summary& summary );
+//! @brief 統計をクリアする
+void Reset();
+
+/**
+ * @brief 統計を画面右上に半透明で重ねて表示するか設定する
+ *        どのタスクから呼んでもよい。表示の切り替えは合成タスクの次のフレームで行う
+ */
+void SetHudVisible( bool visible );
+bool IsHudVisible();
+//! @brief 表示の切り替えと表示内容の更新を行う。合成タスクから 1 フレームに 1 回呼ぶ
+void UpdateHud();
+//! @brief オーバーレイのレイヤーID。未作成なら 0。クリックの対象から外すために合成タスクから参照する
+LayerID HudLayerID();
+
+}
@@ -51,7 +51,6 @@ EXTERN driver::net::e1000e::Context* g_e1000e_Ctx;
 EXTERN uint32_t g_e1000eRxIntCnt;
 EXTERN LayerManager* g_LayerManager;
 EXTERN ActiveLayer* g_ActiveLayer;
-EXTERN int g_MouseLayerID;
 EXTERN std::shared_ptr<Window> g_MainWindow;
 EXTERN int g_MainWindowLayerID;
 EXTERN std::shared_ptr<TopLevelWindow> g_TextBoxWindow;
@@ -64,4 +63,5 @@ EXTERN std::array<InterruptDescriptor, 256> g_IDT;
 
 EXTERN const acpi::FADT* g_FADT;
 EXTERN unsigned long g_LApicTimerFreq;
-#endif
\ No newline at end of file
+EXTERN uint64_t g_TSCFreq;
+#endif
\ No newline at end of file
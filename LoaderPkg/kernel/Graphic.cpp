@@ -48,49 +48,44 @@ const char sk_MouseCursorShape[k_MouseCursorHeight][k_MouseCursorWidth + 1] = {
 // 
 void FillRectAngle( IPixelWriter& writer, const Vector2<int>& pos, const Vector2<int>& size, const PixelColor& color )
 {
-    for( int dy = 0; dy < size.y; ++dy ){
-        for( int dx = 0; dx < size.x; ++dx ){
-            writer.Write( pos.x + dx, pos.y + dy, color );
-        }
-    }
+    writer.FillRect( pos.x, pos.y, size.x, size.y, color );
 }
 
 void DrawRectAngle( IPixelWriter& writer, const Vector2<int>& pos, const Vector2<int>& size, const PixelColor& color )
 {
-    for( int dy = 0; dy < size.y; ++dy ){
-        writer.Write( pos.x             , pos.y + dy, color );
-        writer.Write( pos.x + size.x - 1, pos.y + dy, color );
-    }
-    for( int dx = 0; dx < size.x; ++dx ){
-        writer.Write( pos.x + dx, pos.y             , color );
-        writer.Write( pos.x + dx, pos.y + size.y - 1, color );
-    }
+    writer.FillRect( pos.x             , pos.y             , 1     , size.y, color );
+    writer.FillRect( pos.x + size.x - 1, pos.y             , 1     , size.y, color );
+    writer.FillRect( pos.x             , pos.y             , size.x, 1     , color );
+    writer.FillRect( pos.x             , pos.y + size.y - 1, size.x, 1     , color );
 }
 
 void EraseMouseCursor( IPixelWriter& writer, const Vector2<int>& pos, const PixelColor& back_color )
 {
-    for( int dy = 0; dy < k_MouseCursorHeight; ++dy ){
-        for( int dx = 0; dx < k_MouseCursorWidth; ++dx ){
-            writer.Write( pos.x + dx, pos.y + dy, back_color );
-        }
-    }
+    writer.FillRect( pos.x, pos.y, k_MouseCursorWidth, k_MouseCursorHeight, back_color );
 }
 
 void DrawMouseCursor( IPixelWriter& writer, const Vector2<int>& pos )
 {
+    const auto format = writer.Format();
+    const uint32_t black = PackPixel( format, {0, 0, 0} );
+    const uint32_t white = PackPixel( format, {255, 255, 255} );
+    const uint32_t transparent = PackPixel( format, k_MouseTransparentColor );
+
+    uint32_t image[k_MouseCursorHeight][k_MouseCursorWidth];
     for( int dy = 0; dy < k_MouseCursorHeight; ++dy ){
         for( int dx = 0; dx < k_MouseCursorWidth; ++dx ){
             if( sk_MouseCursorShape[dy][dx] == '@' ){
-                writer.Write( pos.x + dx, pos.y + dy, {0, 0, 0} );
+                image[dy][dx] = black;
             }
             else if( sk_MouseCursorShape[dy][dx] == '.' ){
-                writer.Write( pos.x + dx, pos.y + dy, {255, 255, 255} );
+                image[dy][dx] = white;
             }
             else {
-                writer.Write( pos.x + dx, pos.y + dy, k_MouseTransparentColor );
+                image[dy][dx] = transparent;
             }
         }
     }
+    writer.Blit( pos.x, pos.y, &image[0][0], k_MouseCursorWidth, k_MouseCursorWidth, k_MouseCursorHeight );
 }
 
 void DrawDesktop( IPixelWriter& writer )
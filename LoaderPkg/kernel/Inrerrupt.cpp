@@ -12,8 +12,22 @@
 #include "logger.hpp"
 #include "asmfunc.h"
 #include "Task.hpp"
+#include "Profiler.hpp"
+#include "Trace.hpp"
+#include "WorkQueue.hpp"
+#include "usb/xhci/xhci.hpp"
 
 
+namespace
+{
+    void ProcessXHCIEvents( uint64_t arg )
+    {
+        usb::xhci::ProcessEvents();
+    }
+
+    WorkItem s_XHCIWork( ProcessXHCIEvents );
+}
+
 void InitializeInterrupt()
 {
     const uint16_t cs = GetCS();
@@ -36,22 +50,29 @@ void InitializeInterrupt()
 __attribute__((interrupt))
 void IntHandlerXHCI( InterruptFrame* frame )
 {
-    TaskManager::Instance().SendMessage( TaskManager::k_MainTaskID, Message{Message::k_InterruptXHCI, TaskManager::k_MainTaskID} );
+    TRACE( trace::k_IntEntry, InterruptVector::kXHCI, 0 );
+    QueueWork( s_XHCIWork );
     NotifyEndOfInterrupt();
+    TRACE( trace::k_IntExit, InterruptVector::kXHCI, 0 );
 }
 
 __attribute__((interrupt))
 void IntHandlerLAPICTimer( InterruptFrame* frame )
 {
+    TRACE( trace::k_IntEntry, InterruptVector::kAPICTimer, 0 );
+    profiler::OnTimerInterrupt( *frame );
     LAPICTimerOnInterrupt();
     NotifyEndOfInterrupt();
+    TRACE( trace::k_IntExit, InterruptVector::kAPICTimer, 0 );
 }
 
 __attribute__((interrupt))
 void IntHandlerE1000E( InterruptFrame* frame )
 {
+    TRACE( trace::k_IntEntry, InterruptVector::kE1000E, 0 );
     driver::net::e1000e::InterruptHandler();
     NotifyEndOfInterrupt();
+    TRACE( trace::k_IntExit, InterruptVector::kE1000E, 0 );
 }
 
 void NotifyEndOfInterrupt()
@@ -0,0 +1,152 @@
+//
+// include files
+//
+#include <algorithm>
+#include <array>
+
+#include "InterruptGuard.hpp"
+#include "asmfunc.h"
+
+//
+// constant
+//
+namespace
+{
+    constexpr uint64_t k_RFlagsIF = 1u << 9;
+}
+
+//
+// static variables
+//
+namespace
+{
+    // 記録は常に割り込み禁止中に行うので、シングルCPUではロック不要
+    std::array<InterruptMaskSiteStats, k_MaxInterruptGuardSites> s_Sites;
+    uint64_t s_Histogram[k_InterruptMaskHistogramBuckets];
+
+    // 現在計測中の区間
+    InterruptGuard* s_ActiveGuard = nullptr;
+    uint64_t s_LastSwitchTSC = 0;
+}
+
+//
+// static function declaration
+// 
+namespace
+{
+    uint64_t SaveFlagsAndDisable();
+    void Record( const char* function, int line, uint64_t cycles );
+}
+
+//
+// funcion definitions
+// 
+namespace
+{
+    uint64_t SaveFlagsAndDisable()
+    {
+        uint64_t rflags;
+        __asm__ volatile( "pushfq\n\tpopq %0\n\tcli" : "=r"(rflags) :: "memory" );
+        return rflags;
+    }
+
+    void Record( const char* function, int line, uint64_t cycles )
+    {
+        const int bucket = cycles == 0 ? 0 : 63 - __builtin_clzll( cycles );
+        ++s_Histogram[std::min<int>( bucket, k_InterruptMaskHistogramBuckets - 1 )];
+
+        // 関数名のポインタと行番号で呼び出し元を識別する
+        const std::size_t hash = (reinterpret_cast<uintptr_t>(function) >> 3) ^ (line * 31);
+        for( std::size_t i = 0; i < k_MaxInterruptGuardSites; ++i ){
+            auto& site = s_Sites[(hash + i) % k_MaxInterruptGuardSites];
+            if( site.Function == nullptr ){
+                site.Function = function;
+                site.Line = line;
+            }
+            if( site.Function == function && site.Line == line ){
+                ++site.Count;
+                site.TotalCycles += cycles;
+                site.MaxCycles = std::max( site.MaxCycles, cycles );
+                return;
+            }
+        }
+        // テーブルが満杯なら呼び出し元別の記録は諦める(ヒストグラムには反映済み)
+    }
+}
+
+InterruptGuard::InterruptGuard( const char* function, int line )
+    : m_Function( function ),
+      m_Line( line ),
+      m_Restore( false ),
+      m_StartTSC( 0 ),
+      m_MaskedCycles( 0 )
+{
+    const uint64_t rflags = SaveFlagsAndDisable();
+    if( rflags & k_RFlagsIF ){
+        m_Restore = true;
+        m_StartTSC = ReadTSC();
+        s_ActiveGuard = this;
+    }
+}
+
+InterruptGuard::~InterruptGuard()
+{
+    Release();
+}
+
+void InterruptGuard::Release()
+{
+    if( !m_Restore ){
+        return;
+    }
+    m_Restore = false;
+
+    // 途中でタスクが切り替わっていれば、切り替え前の区間と復帰してからの区間を合わせる
+    const uint64_t tsc = ReadTSC();
+    const uint64_t start = std::max( m_StartTSC, s_LastSwitchTSC );
+    Record( m_Function, m_Line, m_MaskedCycles + (tsc - start) );
+    if( s_ActiveGuard == this ){
+        s_ActiveGuard = nullptr;
+    }
+
+    __asm__ volatile( "sti" ::: "memory" );
+}
+
+void InterruptGuardOnSwitchTask( uint64_t tsc )
+{
+    // 記録は Release() で行い、ここでは切り替え前の区間を足し込むだけにする
+    if( s_ActiveGuard ){
+        const uint64_t start = std::max( s_ActiveGuard->m_StartTSC, s_LastSwitchTSC );
+        s_ActiveGuard->m_MaskedCycles += tsc - start;
+        s_ActiveGuard = nullptr;
+    }
+    s_LastSwitchTSC = tsc;
+}
+
+void GetInterruptMaskStats( std::vector<InterruptMaskSiteStats>& sites )
+{
+    InterruptGuard guard;
+
+    sites.clear();
+    for( const auto& site : s_Sites ){
+        if( site.Function ){
+            sites.push_back( site );
+        }
+    }
+
+    std::sort( sites.begin(), sites.end(),
+               []( const auto& a, const auto& b ){ return a.MaxCycles > b.MaxCycles; } );
+}
+
+void GetInterruptMaskHistogram( uint64_t (&hist)[k_InterruptMaskHistogramBuckets] )
+{
+    InterruptGuard guard;
+    std::copy( std::begin(s_Histogram), std::end(s_Histogram), std::begin(hist) );
+}
+
+void ResetInterruptMaskStats()
+{
+    InterruptGuard guard;
+    s_Sites.fill( InterruptMaskSiteStats{} );
+    std::fill( std::begin(s_Histogram), std::end(s_Histogram), 0 );
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+// 
+// include headers
+//
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+//
+// constants
+//
+//! @brief 記録する呼び出し元の最大数
+constexpr std::size_t k_MaxInterruptGuardSites = 64;
+//! @brief 割り込み禁止時間ヒストグラムのバケット数(log2(TSCサイクル数)毎)
+constexpr std::size_t k_InterruptMaskHistogramBuckets = 48;
+
+//
+// typedef structures
+//
+//! @brief 呼び出し元毎の割り込み禁止時間統計
+struct InterruptMaskSiteStats
+{
+    const char* Function;
+    int Line;
+    uint64_t Count;
+    uint64_t MaxCycles;
+    uint64_t TotalCycles;
+};
+
+/**
+ * @brief 割り込みを禁止し、スコープを抜けるときに元の状態へ戻す
+ *        割り込みが許可されていた状態から禁止した場合のみ、
+ *        禁止していた時間を TSC で計測して呼び出し元毎に記録する
+ *        既に割り込み禁止中(割り込みハンドラ内やネスト)なら何もしない
+ */
+class InterruptGuard
+{
+public:
+
+    InterruptGuard( const char* function = __builtin_FUNCTION(), int line = __builtin_LINE() );
+    ~InterruptGuard();
+
+    InterruptGuard( const InterruptGuard& ) = delete;
+    InterruptGuard& operator=( const InterruptGuard& ) = delete;
+
+    //! @brief スコープの終わりを待たずに割り込み状態を元に戻す
+    void Release();
+
+private:
+
+    friend void InterruptGuardOnSwitchTask( uint64_t tsc );
+
+    const char* m_Function;
+    int m_Line;
+    bool m_Restore;
+    uint64_t m_StartTSC;
+    uint64_t m_MaskedCycles;    //! タスクが切り替わるまでに禁止していたサイクル数
+};
+
+/**
+ * @brief タスク切り替え時に呼び出す
+ *        切り替え前のタスクの割り込み禁止区間をここで区切って保持し、
+ *        切り替えていた時間を除いて Release() でまとめて1回として記録する
+ */
+void InterruptGuardOnSwitchTask( uint64_t tsc );
+
+/**
+ * @brief 呼び出し元毎の統計を最大禁止時間の降順で取得する
+ */
+void GetInterruptMaskStats( std::vector<InterruptMaskSiteStats>& sites );
+//! @brief 割り込み禁止時間のヒストグラムを取得する。i 番目は [2^i, 2^(i+1)) サイクル
+void GetInterruptMaskHistogram( uint64_t (&hist)[k_InterruptMaskHistogramBuckets] );
+//! @brief 統計をクリアする
+void ResetInterruptMaskStats();
@@ -23,6 +23,11 @@
 #include "PixelWriter.hpp"
 #include "Font.hpp"
 #include "Terminal.hpp"
+#include "Serial.hpp"
+#include "InterruptGuard.hpp"
+#include "WorkQueue.hpp"
+#include "BlitKernel.hpp"
+#include "Compositor.hpp"
 
 #include "asmfunc.h"
 #include "usb/memory.hpp"
@@ -38,6 +43,8 @@
 // 
 // constant
 //
+//! カウンタなど定期的に描き直す部品を更新するタイマ (画面合成と同じ周期)
+constexpr int k_WidgetTimerValue = 0x77646774;  // 'wdgt'
 
 // 
 // static variables
@@ -74,6 +81,7 @@ static void TaskB( uint64_t task_id, int64_t data );
 
 static void InputTextWindow( char c );
 static void DrawTextCursor( bool visible );
+static void DrawCounter();
 
 
 extern "C" void KernelMainNewStack( const FrameBufferConfig* config_in, 
@@ -87,6 +95,8 @@ extern "C" void KernelMainNewStack( const FrameBufferConfig* config_in,
 
 
     SetupMemory();
+    serial::Initialize();
+    blit::Initialize();
     acpi::Initialize( *reinterpret_cast<const acpi::RSDP*>(acpi_table) );
     InitializeLAPICTimer();
 
@@ -115,6 +125,12 @@ extern "C" void KernelMainNewStack( const FrameBufferConfig* config_in,
 
     InitializeTaskBWindow( config );
     InitializeTask();
+    InitializeWorkQueue();
+
+    // レイヤーを作り終えてから画面の操作を合成タスクに任せる
+    Terminal* terminal = new Terminal();
+    compositor::Initialize();
+
     usb::xhci::Initialize();
     InitializeMouse();
     Keyboard::InitializeKeyboard();
@@ -129,8 +145,6 @@ extern "C" void KernelMainNewStack( const FrameBufferConfig* config_in,
         ID();
 #endif
 
-    Terminal* terminal = new Terminal();
-
     Task& main_task = TaskManager::Instance().CurrentTask();
     //TimerManager::Instance().AddTimer( Timer(100, 1) );
     //TimerManager::Instance().AddTimer( Timer(200, -1) );
@@ -151,37 +165,42 @@ extern "C" void KernelMainNewStack( const FrameBufferConfig* config_in,
         Printk("\n");
     }
 
-    while(1){
-        ++s_Count;
-        sprintf( s_String, "%010u", s_Count );
-        FillRectAngle( *g_MainWindow->Writer(), {24, 28}, {8*10, 16}, {0xc6, 0xc6, 0xc6} );
-        WriteString( *g_MainWindow->Writer(), 24, 28, s_String, {0, 0, 0} );
-        g_LayerManager->Draw( g_MainWindowLayerID );
+    {
+        InterruptGuard guard;
+        TimerManager::Instance().AddTimer( Timer(compositor::k_FramePeriod, k_WidgetTimerValue) );
+    }
 
-        __asm__("cli");
+    // 届いているメッセージを全て処理してから，フレームごとに部品を描き直す
+    bool widget_due = false;
+    while(1){
+        InterruptGuard guard;
         auto msg = main_task.ReceiveMessage();
         if( !msg ){
+            if( widget_due ){
+                guard.Release();
+                widget_due = false;
+                DrawCounter();
+                continue;
+            }
             main_task.Sleep();
-            __asm__("sti");
             continue;
         }
-        __asm__("sti");
+        guard.Release();
 
+        // 部品を描き直すためのタイマは数えない (数えると毎フレーム描き直すことになる)
+        if( msg->Type != Message::k_TimerTimeout || msg->Arg.Timer.Value != k_WidgetTimerValue ){
+            ++s_Count;
+        }
         switch( msg->Type ){
-        case Message::k_InterruptXHCI:
-
-            while( g_xHC_Controller->PrimaryEventRing()->HasFront() ){
-                auto err = ProcessEvent( *g_xHC_Controller );
-                if( err ){
-                    Log( kDebug, "Error while ProcessEvent: %s at %s:%d\n",
-                        err.Name(), err.File(), err.Line() );
-                }
-            }
-            break;
         case Message::k_InterruptLAPICTimer:
             //Printk( "Timer interrupt\n" );
             break;
         case Message::k_TimerTimeout:
+            if( msg->Arg.Timer.Value == k_WidgetTimerValue ){
+                widget_due = true;
+                InterruptGuard timer_guard;
+                TimerManager::Instance().AddTimer( Timer(compositor::k_FramePeriod, k_WidgetTimerValue) );
+            }
             break;
         case Message::k_KeyPush:
         {
@@ -204,12 +223,6 @@ extern "C" void KernelMainNewStack( const FrameBufferConfig* config_in,
             }
         }
   
-            break;
-        case Message::k_Layer:
-            ProcessLayerMessage(*msg);
-            __asm__("cli");
-             TaskManager::Instance().SendMessage(msg->SrcTask, Message{Message::k_LayerFinish, main_task.ID()});
-            __asm__("sti");
             break;
         default:
             Log( kError, "Unknown message type: %d\n", msg->Type );
@@ -340,38 +353,29 @@ static void TaskB( uint64_t task_id, int64_t data )
     char str[128];
     int count = 0;
 
-    Task& taskb = TaskManager::Instance().CurrentTask();
     while( 1 ){
         ++count;
         sprintf( str, "%010d", count );
         FillRectAngle( *s_TaskBWindow->Writer(), {24, 28}, { 8*10, 16}, {0xc6, 0xc6, 0xc6} );
         WriteString( *s_TaskBWindow->Writer(), 24, 28, str, {0, 0, 0} );
-        //g_LayerManager->Draw( s_TaskBWindowLayerID );
-
-        Message msg{Message::k_Layer, taskb.ID()};
-        msg.Arg.Layer.LayerId = s_TaskBWindowLayerID;
-        msg.Arg.Layer.op = LayerOperation::Draw;
-        __asm__("cli");
-        TaskManager::Instance().SendMessage(1, msg);
-        __asm__("sti");
-
-        while(1){
-            __asm__("cli");
-            auto msg = taskb.ReceiveMessage();
-            if( !msg ){
-                taskb.Sleep();
-                __asm__("sti");
-                continue;
-            }
-            __asm__("sti");
-            
-            if( msg->Type == Message::k_LayerFinish ){
-                break;
-            }
-        }
+        compositor::Draw( s_TaskBWindowLayerID );
     }
 }
 
+//! @brief メインループが処理したメッセージ数 (部品の描き直し用タイマを除く) を表示する。変化が無ければ描かない
+static void DrawCounter()
+{
+    static unsigned int s_DrawnCount = 0;
+    if( s_DrawnCount == s_Count ){
+        return;
+    }
+    s_DrawnCount = s_Count;
+
+    sprintf( s_String, "%010u", s_Count );
+    WriteString( *g_MainWindow->Writer(), 24, 28, s_String, {0, 0, 0}, {0xc6, 0xc6, 0xc6} );
+    compositor::Draw( g_MainWindowLayerID, {{24, 28}, {8 * 10, 16}} );
+}
+
 static void DrawTextCursor( bool visible )
 {
     auto text_window = g_TextBoxWindow;
@@ -404,7 +408,7 @@ static void InputTextWindow( char c )
         DrawTextCursor(true);
     }
 
-    g_LayerManager->Draw(g_TextBoxWindowID);
+    compositor::Draw(g_TextBoxWindowID);
 }
 
 extern "C" void __cxa_pure_virtual() {
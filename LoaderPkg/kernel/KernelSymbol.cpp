@@ -0,0 +1,73 @@
+//
+// include files
+//
+#include "KernelSymbol.hpp"
+
+//
+// static variables
+//
+
+// リンク後に tools/makesymtab.py で生成したテーブルで上書きされる
+// 定数畳み込みされないよう const にはしない
+alignas(16) __attribute__((section(".ksyms"), used))
+uint8_t g_KernelSymbolTable[ksym::k_SymbolTableSize];
+
+namespace ksym
+{
+//
+// static function declaration
+// 
+namespace
+{
+    const SymbolTableHeader* Header()
+    {
+        return reinterpret_cast<const SymbolTableHeader*>(g_KernelSymbolTable);
+    }
+
+    const SymbolEntry* Entries()
+    {
+        return reinterpret_cast<const SymbolEntry*>(g_KernelSymbolTable + sizeof(SymbolTableHeader));
+    }
+}
+
+//
+// funcion definitions
+// 
+bool Available()
+{
+    return Header()->Magic == k_SymbolTableMagic && Header()->Count > 0;
+}
+
+const char* Lookup( uint64_t addr, uint64_t* start )
+{
+    if( !Available() ){
+        return nullptr;
+    }
+
+    const SymbolEntry* entries = Entries();
+    uint32_t count = Header()->Count;
+    if( addr < entries[0].Addr ){
+        return nullptr;
+    }
+
+    // addr 以下で最大のアドレスを持つシンボルを二分探索する
+    uint32_t lo = 0;
+    uint32_t hi = count;
+    while( hi - lo > 1 ){
+        uint32_t mid = lo + (hi - lo) / 2;
+        if( entries[mid].Addr <= addr ){
+            lo = mid;
+        }
+        else {
+            hi = mid;
+        }
+    }
+
+    if( start ){
+        *start = entries[lo].Addr;
+    }
+    const char* strtab = reinterpret_cast<const char*>(g_KernelSymbolTable + Header()->StringTableOffset);
+    return strtab + entries[lo].NameOffset;
+}
+
+}
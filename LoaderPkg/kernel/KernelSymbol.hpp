@@ -0,0 +1,49 @@
+#pragma once
+
+// 
+// include headers
+//
+#include <cstdint>
+#include <cstddef>
+
+namespace ksym
+{
+
+/**
+ * @brief ビルド時に埋め込まれたシンボルテーブルのレイアウト
+ *        tools/makesymtab.py で生成し、リンク後に .ksyms セクションへ書き込む
+ *
+ *  SymbolTableHeader
+ *  SymbolEntry[Count]     アドレス昇順
+ *  文字列テーブル          '\0' 区切り
+ */
+constexpr uint32_t k_SymbolTableMagic = 0x4D59534B;     // "KSYM"
+constexpr std::size_t k_SymbolTableSize = 256 * 1024;
+
+struct SymbolTableHeader
+{
+    uint32_t Magic;
+    uint32_t Count;
+    uint32_t StringTableOffset;
+    uint32_t Reserved;
+} __attribute__((packed));
+
+struct SymbolEntry
+{
+    uint64_t Addr;
+    uint32_t NameOffset;
+    uint32_t Reserved;
+} __attribute__((packed));
+
+//! @brief シンボルテーブルが埋め込まれているか
+bool Available();
+
+/**
+ * @brief アドレスを含むシンボルを検索する
+ * @param [in]  addr    検索するアドレス
+ * @param [out] start   見つかったシンボルの先頭アドレス
+ * @return シンボル名。見つからなければ nullptr
+ */
+const char* Lookup( uint64_t addr, uint64_t* start );
+
+}
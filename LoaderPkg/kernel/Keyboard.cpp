@@ -6,6 +6,7 @@
 #include "Event.hpp"
 #include "Global.hpp"
 #include "Task.hpp"
+#include "InterruptGuard.hpp"
 
 #include <memory>
 #include "usb/classdriver/keyboard.hpp"
@@ -100,6 +101,8 @@ void InitializeKeyboard()
 
             Message msg{ Message::k_KeyPush, TaskManager::k_MainTaskID };
             msg.Arg.Keyboard.Key = Key( modifier, keycode );
+            // ワーカータスクから呼ばれるので，タイマ割り込みからの送信と競合しないよう割り込みを禁止する
+            InterruptGuard guard;
             TaskManager::Instance().SendMessage( TaskManager::k_MainTaskID, msg );
         };
 }
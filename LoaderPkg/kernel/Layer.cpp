@@ -2,9 +2,15 @@
 // include files
 //
 #include "Layer.hpp"
+
+#include <algorithm>
+#include <limits>
+
 #include "Global.hpp"
 #include "Graphic.hpp"
 #include "MouseCursor.hpp"
+#include "Trace.hpp"
+#include "asmfunc.h"
 
 //
 // constant
@@ -17,17 +23,62 @@
 //
 // static function declaration
 // 
+namespace
+{
+    bool IsEmpty( const RectAngle<int>& r );
+    void SubtractRect( const RectAngle<int>& a, const RectAngle<int>& b, std::vector<RectAngle<int>>& out );
+}
 
 //
 // funcion definitions
 // 
+namespace
+{
+    bool IsEmpty( const RectAngle<int>& r )
+    {
+        return r.size.x <= 0 || r.size.y <= 0;
+    }
+
+    //! @brief a から b を除いた部分を最大4つの矩形にして out に追加する
+    void SubtractRect( const RectAngle<int>& a, const RectAngle<int>& b, std::vector<RectAngle<int>>& out )
+    {
+        const auto overlap = a.Intersection( b );
+        if( IsEmpty( overlap ) ){
+            out.push_back( a );
+            return;
+        }
+
+        const auto a_end = a.pos + a.size;
+        const auto o_end = overlap.pos + overlap.size;
+
+        // 上
+        if( overlap.pos.y > a.pos.y ){
+            out.push_back( {a.pos, {a.size.x, overlap.pos.y - a.pos.y}} );
+        }
+        // 下
+        if( o_end.y < a_end.y ){
+            out.push_back( {{a.pos.x, o_end.y}, {a.size.x, a_end.y - o_end.y}} );
+        }
+        // 左
+        if( overlap.pos.x > a.pos.x ){
+            out.push_back( {{a.pos.x, overlap.pos.y}, {overlap.pos.x - a.pos.x, overlap.size.y}} );
+        }
+        // 右
+        if( o_end.x < a_end.x ){
+            out.push_back( {{o_end.x, overlap.pos.y}, {a_end.x - o_end.x, overlap.size.y}} );
+        }
+    }
+}
 
     //! @brief 指定されたIDを持つレイヤーを生成する
 Layer::Layer( LayerID id )
     : m_ID(id),
       m_Pos{0, 0},
       m_Draggable( false ),
-      m_Window()
+      m_Window(),
+      m_Height( -1 ),
+      m_IndexedArea{{0, 0}, {0, 0}},
+      m_Indexed( false )
 {}
 
 LayerID Layer::ID() const
@@ -82,64 +133,94 @@ Vector2<int> Layer::GetPosition() const
     return m_Pos;
 }
 
+RectAngle<int> Layer::Area() const
+{
+    if( !m_Window ){
+        return {m_Pos, {0, 0}};
+    }
+    return {m_Pos, m_Window->Size()};
+}
+
+bool Layer::IsOpaque() const
+{
+    return m_Window && m_Window->IsOpaque();
+}
+
+int Layer::Height() const
+{
+    return m_Height;
+}
+
 LayerManager::LayerManager()
     : m_Screen( nullptr ),
       m_BackBuffer(),
+      m_Damage(),
+      m_Grid(),
+      m_Candidates(),
+      m_VisibleRects(),
+      m_Uncovered(),
+      m_UncoveredNext(),
+      m_Frame(),
+      m_ScreenBytes( 0 ),
+      m_CursorImage(),
+      m_CursorPos{0, 0},
+      m_CursorBuffer(),
       m_Layers(),
       m_LayerStack(),
       m_LatestID( 0 )
-{}
+{
+    // ID 0 はレイヤー無しを表すので欠番にしておく
+    m_Layers.emplace_back();
+}
 
 void LayerManager::SetWriter( FrameBuffer* screen )
 {
     m_Screen = screen;
+    m_ScreenBytes = screen->WrittenBytes();
 
     FrameBufferConfig back_config = screen->Config();
     back_config.FrameBuffer = nullptr;
     m_BackBuffer.Initialize( back_config );
+
+    m_Grid.Initialize( {static_cast<int>(back_config.HorizontalResolution),
+                        static_cast<int>(back_config.VerticalResolution)} );
+    for( auto layer : m_LayerStack ){
+        layer->m_Indexed = false;
+        Reindex( layer );
+    }
 }
 
 Layer& LayerManager::NewLayer()
 {
     ++m_LatestID;
+    // ID は 1 から連番なので，末尾に追加すれば添字と ID が一致する
     return *(m_Layers.emplace_back( std::make_unique<Layer>(m_LatestID) ));
 }
 
-void LayerManager::Draw( const RectAngle<int>& area ) const
+void LayerManager::Draw( const RectAngle<int>& area )
 {
-    for( auto layer : m_LayerStack ){
-        layer->DrawTo( m_BackBuffer, area );
-    }
-    m_Screen->Copy( area.pos, m_BackBuffer, area );
+    Invalidate( area );
 }
 
-void LayerManager::Draw( unsigned int id) const
+void LayerManager::Draw( unsigned int id )
 {
     Draw( id, {{0, 0}, {-1, -1}} );
 }
 
-void LayerManager::Draw( unsigned int id, RectAngle<int> area ) const
+void LayerManager::Draw( unsigned int id, RectAngle<int> area )
 {
-    bool draw = false;
-    RectAngle<int> window_area;
-
-    for( auto layer : m_LayerStack ){
-        if( layer->ID() == id ){
-            window_area.size = layer->GetWindow()->Size();
-            window_area.pos  = layer->GetPosition();
-            if( area.size.x >= 0 || area.size.y >= 0 ){
-                area.pos = area.pos + window_area.pos;
-                window_area = window_area.Intersection( area );
-            }
-            draw = true;
-        }
+    auto layer = FindLayer( id );
+    if( layer == nullptr || !layer->GetWindow() ){
+        return;
+    }
 
-        if( draw ){
-            layer->DrawTo( m_BackBuffer, window_area );
-        }
+    RectAngle<int> window_area{ layer->GetPosition(), layer->GetWindow()->Size() };
+    if( area.size.x >= 0 || area.size.y >= 0 ){
+        area.pos = area.pos + window_area.pos;
+        window_area = window_area.Intersection( area );
     }
 
-    m_Screen->Copy( window_area.pos, m_BackBuffer, window_area );
+    Invalidate( window_area );
 }
 
 void LayerManager::Move( LayerID id, Vector2<int> new_pos )
@@ -148,9 +229,10 @@ void LayerManager::Move( LayerID id, Vector2<int> new_pos )
     const auto window_size = layer->GetWindow()->Size();
     const auto old_pos = layer->GetPosition();
     layer->Move( new_pos );
+    Reindex( layer );
     
-    Draw( {old_pos, window_size} );
-    Draw( id );
+    Invalidate( {old_pos, window_size} );
+    Invalidate( {new_pos, window_size} );
 }
 
 void LayerManager::MoveRelative( LayerID id, Vector2<int> pos_diff )
@@ -160,8 +242,147 @@ void LayerManager::MoveRelative( LayerID id, Vector2<int> pos_diff )
     const auto old_pos = layer->GetPosition();
 
     layer->MoveRelative( pos_diff );
-    Draw( {old_pos, window_size} );
-    Draw( id );
+    Reindex( layer );
+    Invalidate( {old_pos, window_size} );
+    Invalidate( {layer->GetPosition(), window_size} );
+}
+
+void LayerManager::Invalidate( const RectAngle<int>& area )
+{
+    const auto& config = m_Screen->Config();
+    const RectAngle<int> screen_area{ {0, 0}, {static_cast<int>(config.HorizontalResolution),
+                                               static_cast<int>(config.VerticalResolution)} };
+    m_Damage.Add( screen_area.Intersection( area ) );
+}
+
+void LayerManager::Flush()
+{
+    // 再描写するものが無ければフレームとして記録しない
+    if( m_Damage.Empty() ){
+        return;
+    }
+
+    const uint64_t start_tsc = ReadTSC();
+    m_Frame = gfxstat::FrameStats{};
+    m_Frame.DamageRects = m_Damage.Count();
+
+    for( const auto& area : m_Damage ){
+        TRACE( trace::k_LayerDraw, 0, trace::PackRect(area.pos.x, area.pos.y, area.size.x, area.size.y) );
+        ComputeVisibleRects( area );
+        // 上のレイヤーから求めているので，逆順にたどって下から描く
+        for( auto itr = m_VisibleRects.rbegin(); itr != m_VisibleRects.rend(); ++itr ){
+            itr->first->DrawTo( m_BackBuffer, itr->second );
+            ++m_Frame.DrawCalls;
+            m_Frame.PixelsComposited += static_cast<uint64_t>(itr->second.size.x) * itr->second.size.y;
+        }
+        m_Screen->Copy( area.pos, m_BackBuffer, area );
+    }
+
+    // 背景を描き直した所にカーソルが掛かっていれば描き直す
+    if( m_CursorImage ){
+        const auto cursor_area = CursorArea();
+        for( const auto& area : m_Damage ){
+            if( !IsEmpty( area.Intersection( cursor_area ) ) ){
+                DrawCursor();
+                break;
+            }
+        }
+    }
+    m_Damage.Clear();
+
+    const uint64_t screen_bytes = m_Screen->WrittenBytes();
+    m_Frame.BytesToScreen = screen_bytes - m_ScreenBytes;
+    m_ScreenBytes = screen_bytes;
+    m_Frame.Cycles = ReadTSC() - start_tsc;
+    gfxstat::RecordFrame( m_Frame );
+}
+
+void LayerManager::SetCursor( const std::shared_ptr<Window>& image, Vector2<int> pos )
+{
+    if( m_CursorImage ){
+        Invalidate( CursorArea() );
+    }
+
+    m_CursorImage = image;
+    m_CursorPos = pos;
+
+    FrameBufferConfig config = m_Screen->Config();
+    config.FrameBuffer = nullptr;
+    config.HorizontalResolution = image->Width();
+    config.VerticalResolution = image->Height();
+    m_CursorBuffer.Initialize( config );
+
+    Invalidate( CursorArea() );
+}
+
+void LayerManager::MoveCursor( Vector2<int> pos )
+{
+    if( !m_CursorImage || (pos.x == m_CursorPos.x && pos.y == m_CursorPos.y) ){
+        return;
+    }
+
+    // バックバッファにはカーソルを除いた画面が入っているので，そこから元の位置を復元する
+    const auto old_area = CursorArea();
+    m_Screen->Copy( old_area.pos, m_BackBuffer, old_area );
+
+    m_CursorPos = pos;
+    DrawCursor();
+}
+
+RectAngle<int> LayerManager::CursorArea() const
+{
+    return {m_CursorPos, m_CursorImage->Size()};
+}
+
+void LayerManager::DrawCursor()
+{
+    const auto area = CursorArea();
+    const RectAngle<int> image_area{ {0, 0}, area.size };
+
+    m_CursorBuffer.Copy( {0, 0}, m_BackBuffer, area );
+    m_CursorImage->DrawTo( m_CursorBuffer, {0, 0}, image_area );
+    m_Screen->Copy( area.pos, m_CursorBuffer, image_area );
+}
+
+void LayerManager::ComputeVisibleRects( const RectAngle<int>& area )
+{
+    m_VisibleRects.clear();
+    m_Uncovered.clear();
+    m_Uncovered.push_back( area );
+
+    // area に掛かるレイヤーだけを上から順に調べる
+    m_Candidates.clear();
+    m_Grid.Query( area, m_Candidates );
+    std::sort( m_Candidates.begin(), m_Candidates.end(), []( const Layer* a, const Layer* b ){
+        return a->m_Height > b->m_Height;
+    } );
+    m_Candidates.erase( std::unique( m_Candidates.begin(), m_Candidates.end() ), m_Candidates.end() );
+
+    for( auto itr = m_Candidates.begin(); itr != m_Candidates.end() && !m_Uncovered.empty(); ++itr ){
+        const Layer* layer = *itr;
+        const auto layer_area = layer->Area();
+        ++m_Frame.LayersVisited;
+        if( IsEmpty( layer_area ) ){
+            continue;
+        }
+
+        for( const auto& r : m_Uncovered ){
+            const auto visible = r.Intersection( layer_area );
+            if( !IsEmpty( visible ) ){
+                m_VisibleRects.emplace_back( layer, visible );
+            }
+        }
+
+        // 不透明なレイヤーの下は見えないので，以降のレイヤーの対象から外す
+        // 矩形が増えすぎた場合は外さずに描く(重ね描きになるだけで結果は同じ)
+        if( layer->IsOpaque() && m_Uncovered.size() <= k_MaxUncoveredRects ){
+            m_UncoveredNext.clear();
+            for( const auto& r : m_Uncovered ){
+                SubtractRect( r, layer_area, m_UncoveredNext );
+            }
+            m_Uncovered.swap( m_UncoveredNext );
+        }
+    }
 }
 
 void LayerManager::UpDown( LayerID id, int new_height )
@@ -170,99 +391,127 @@ void LayerManager::UpDown( LayerID id, int new_height )
         Hide( id );
         return;
     }
-    if( new_height > m_LayerStack.size() ){
-        new_height = m_LayerStack.size();
+
+    auto layer = FindLayer(id);
+    if( layer == nullptr ){
+        return;
     }
 
-    auto layer   = FindLayer(id);
-    auto old_pos = std::find( m_LayerStack.begin(), m_LayerStack.end(), layer );
-    auto new_pos = m_LayerStack.begin() + new_height;
+    const int size = static_cast<int>( m_LayerStack.size() );
+    const int old_height = layer->m_Height;
 
     // 非表示の場合、新しい位置にレイヤを挿入して終了
-    if( old_pos == m_LayerStack.end() ){
-        m_LayerStack.insert( new_pos, layer );
+    if( old_height < 0 ){
+        new_height = std::min( new_height, size );
+        m_LayerStack.insert( m_LayerStack.begin() + new_height, layer );
+        RenumberHeights( new_height, size + 1 );
+        Reindex( layer );
         return;
     }
 
-    // 一番最後を指している場合、eraseすると end() の向こう側に行ってしまうので一つ戻す
-    if( new_pos == m_LayerStack.end() ){
-        --new_pos;
+    // 表示中のレイヤーは最前面でも size - 1 の位置まで
+    new_height = std::min( new_height, size - 1 );
+    if( new_height == old_height ){
+        return;
     }
 
-    m_LayerStack.erase( old_pos );
-    m_LayerStack.insert( new_pos, layer );
+    // 間にあるレイヤーを 1 つずつずらすだけなので，動かした範囲だけ高さを振り直せばよい
+    auto begin = m_LayerStack.begin();
+    if( old_height < new_height ){
+        std::rotate( begin + old_height, begin + old_height + 1, begin + new_height + 1 );
+        RenumberHeights( old_height, new_height + 1 );
+    }
+    else {
+        std::rotate( begin + new_height, begin + old_height, begin + old_height + 1 );
+        RenumberHeights( new_height, old_height + 1 );
+    }
 }
 
 void LayerManager::Hide( LayerID id )
 {
     auto layer = FindLayer(id);
-    auto pos   = std::find( m_LayerStack.begin(), m_LayerStack.end(), layer );
-    if( pos != m_LayerStack.end() ){
-        m_LayerStack.erase(pos);
+    if( layer == nullptr || layer->m_Height < 0 ){
+        return;
+    }
+
+    const int height = layer->m_Height;
+    m_LayerStack.erase( m_LayerStack.begin() + height );
+    layer->m_Height = -1;
+    RenumberHeights( height, static_cast<int>( m_LayerStack.size() ) );
+    Reindex( layer );
+}
+
+void LayerManager::RenumberHeights( int begin, int end )
+{
+    for( int h = begin; h < end; ++h ){
+        m_LayerStack[h]->m_Height = h;
+    }
+}
+
+void LayerManager::Reindex( Layer* layer )
+{
+    if( layer->m_Indexed ){
+        m_Grid.Remove( layer, layer->m_IndexedArea );
+        layer->m_Indexed = false;
+    }
+
+    const auto area = layer->Area();
+    if( layer->m_Height < 0 || IsEmpty( area ) ){
+        return;
     }
+    m_Grid.Insert( layer, area );
+    layer->m_IndexedArea = area;
+    layer->m_Indexed = true;
 }
 
 Layer* LayerManager::FindLayerByPosition( Vector2<int> pos, unsigned int exclude_id ) const
 {
-    auto pred = [pos, exclude_id]( Layer* layer ){
+    // pos を含むセルに登録されたレイヤーから，pos を含む最も高いものを選ぶ
+    const auto cell = m_Grid.At( pos );
+    if( cell == nullptr ){
+        return nullptr;
+    }
+
+    Layer* found = nullptr;
+    for( auto layer : *cell ){
         if( layer->ID() == exclude_id ){
-            return false;
+            continue;
         }
-        const auto& window = layer->GetWindow();
-        if( !window ){
-            return false;
+        if( found && found->m_Height > layer->m_Height ){
+            continue;
         }
 
         const auto window_pos = layer->GetPosition();
-        const auto window_end_pos = window_pos + window->Size();
-
-        return window_pos.x <= pos.x && pos.x < window_end_pos.x &&
-               window_pos.y <= pos.y && pos.y < window_end_pos.y;
-    };
-
-    auto itr = std::find_if( m_LayerStack.rbegin(), m_LayerStack.rend(), pred );
-    if( itr == m_LayerStack.rend() ){
-        return nullptr;
+        const auto window_end_pos = window_pos + layer->GetWindow()->Size();
+        if( window_pos.x <= pos.x && pos.x < window_end_pos.x &&
+            window_pos.y <= pos.y && pos.y < window_end_pos.y )
+        {
+            found = layer;
+        }
     }
 
-    return *itr;
+    return found;
 }
 
 Layer* LayerManager::FindLayer( LayerID id )
 {
-    auto pred = [id]( const LayerPtr& elem ){
-        return elem->ID() == id;
-    };
-
-    auto itr = std::find_if( m_Layers.begin(), m_Layers.end(), pred );
-    if( itr == m_Layers.end() ){
+    if( id == 0 || id >= m_Layers.size() ){
         return nullptr;
     }
-
-    return itr->get();
+    return m_Layers[id].get();
 }
 
-int LayerManager::GetHeight( unsigned int id )
+int LayerManager::GetHeight( LayerID id )
 {
-    for( int h = 0; h < m_LayerStack.size(); ++h ){
-        if( m_LayerStack[h]->ID() == id ){
-            return h;
-        }
-    }
-    return -1;
+    auto layer = FindLayer( id );
+    return layer ? layer->m_Height : -1;
 }
 
 ActiveLayer::ActiveLayer( LayerManager& manager )
     : m_Manager(manager),
-      m_ActiveLayer(0),
-      m_MouseLayer(0)
+      m_ActiveLayer(0)
 {}
 
-void ActiveLayer::SetMouseLayer( LayerID mouse_layer )
-{
-    m_MouseLayer = mouse_layer;
-}
-
 void ActiveLayer::Activate( LayerID layer_id )
 {
     if( m_ActiveLayer == layer_id ){
@@ -279,8 +528,8 @@ void ActiveLayer::Activate( LayerID layer_id )
     if( m_ActiveLayer > 0 ){
         Layer* layer = g_LayerManager->FindLayer( m_ActiveLayer );
         layer->GetWindow()->Activate();
-        // マウスの一個下のレイヤに表示
-        g_LayerManager->UpDown( m_ActiveLayer, g_LayerManager->GetHeight(m_MouseLayer) - 1 );
+        // 最前面に表示 (マウスカーソルはレイヤーとは別に描かれる)
+        g_LayerManager->UpDown( m_ActiveLayer, std::numeric_limits<int>::max() );
         g_LayerManager->Draw( m_ActiveLayer );
     }
 }
@@ -325,10 +574,6 @@ void CreateLayer( const FrameBufferConfig& config, FrameBuffer* screen )
         .SetWindow( bg_window )
         .Move( {0, 0} )
         .ID();
-    auto mouse_layer_id = g_LayerManager->NewLayer()
-        .SetWindow( mouse_window )
-        .Move( g_MousePosition )
-        .ID();
     auto main_window_layer_id = g_LayerManager->NewLayer()
         .SetWindow( g_MainWindow )
         .SetDraggable( true )
@@ -349,30 +594,8 @@ void CreateLayer( const FrameBufferConfig& config, FrameBuffer* screen )
     g_LayerManager->UpDown( g_Console->LayerID(), 1 );
     g_LayerManager->UpDown( main_window_layer_id, 2 );
     g_LayerManager->UpDown( g_TextBoxWindowID, 3 );
-    g_LayerManager->UpDown( mouse_layer_id, 4 );
+    g_LayerManager->SetCursor( mouse_window, g_MousePosition );
     g_LayerManager->Draw( bglayer_id );
 
-    g_MouseLayerID = mouse_layer_id;
     g_MainWindowLayerID = main_window_layer_id;
 }
-
-void ProcessLayerMessage( const Message& msg )
-{
-    const auto arg = msg.Arg.Layer;
-    switch(arg.op){
-    case LayerOperation::Move:
-        g_LayerManager->Move( arg.LayerId, {arg.x, arg.y} );
-        break;
-    case LayerOperation::MoveRelative:
-        g_LayerManager->MoveRelative( arg.LayerId, {arg.x, arg.y} );
-        break;
-    case LayerOperation::Draw:
-        g_LayerManager->Draw( arg.LayerId );
-        break;
-    case LayerOperation::DrawArea:
-        g_LayerManager->Draw( arg.LayerId, {{arg.x, arg.y}, {arg.w, arg.h}} );
-        break;
-    default:
-        break;
-    }
-}
\ No newline at end of file
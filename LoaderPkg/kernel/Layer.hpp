@@ -6,6 +6,9 @@
 #include "Graphic.hpp"
 #include "Window.hpp"
 #include "Event.hpp"
+#include "Region.hpp"
+#include "LayerGrid.hpp"
+#include "GfxStat.hpp"
 
 class Layer
 {
@@ -27,25 +30,46 @@ public:
     //! @brief 設定されたウィンドウを返す
     std::shared_ptr<Window> GetWindow() const;
 
-    //! @brief レイヤーの位置情報を指定された絶対座標へと更新する。再描写はしない
+    /**
+     * @brief レイヤーの位置情報を指定された絶対座標へと更新する。再描写はしない
+     *        表示中のレイヤーは LayerManager::Move で動かすこと (空間索引が更新されない)
+     */
     Layer& Move( Vector2<int> pos );
     //! @brief レイヤーの位置情報を指定された双代座標へと更新する。再描写はしない
     Layer& MoveRelative( Vector2<int> pos_diff );
 
     //! @brief fb に現在設定されているウィンドウの内容を描写する
     void DrawTo( FrameBuffer& fb, const RectAngle<int>& area ) const;
+    //! @brief レイヤーが覆う画面上の矩形 (ウィンドウが無ければ大きさ 0)
+    RectAngle<int> Area() const;
+    //! @brief 下にあるレイヤーを完全に隠すか
+    bool IsOpaque() const;
 
     //! @brief 左上座標を基準としたレイヤの位置を返す
     Vector2<int> GetPosition() const;
+    //! @brief 重なりの高さ (0 が最背面)。非表示なら -1
+    int Height() const;
 
 private:
 
+    // 高さは LayerManager が重なり順を変える時に更新する
+    friend class LayerManager;
+
     unsigned int m_ID;
     Vector2<int> m_Pos;
     bool m_Draggable;
     std::shared_ptr<Window> m_Window;
+    int m_Height;
+    //! LayerGrid に登録した時の領域 (m_Indexed が true の時のみ有効)
+    RectAngle<int> m_IndexedArea;
+    bool m_Indexed;
 };
 
+/**
+ * @brief レイヤーの重なりを管理し，画面へ合成する
+ *        合成タスクの開始後は合成タスクからのみ操作する
+ *        他のタスクからの再描写・移動は compositor::Draw などで要求する
+ */
 class LayerManager
 {
 public:
@@ -62,17 +86,37 @@ public:
      */
     Layer& NewLayer();
 
+    /**
+     * 以下の Draw / Move はその場では合成せず，再描写が必要な領域を記録するだけ
+     * 実際の合成と画面への転送は Flush でまとめて行う
+     */
     //! @brief 現在表示状態にあるレイヤーのエリアを指定して表示する
-    void Draw( const RectAngle<int>& area ) const;
-    //! @brief 指定されたレイヤーより上にあるレイヤーの部分のみ再描写する
-    void Draw( unsigned int id ) const;
-    //! @brief 指定されたレイヤーより上にあるレイヤーのについて、areaで指定した部分のみ再描写する
-    void Draw( unsigned int id, RectAngle<int> area ) const;
-    //! @brief レイヤーの位置情報を指定された絶対座標へと更新する。再描写はしない
+    void Draw( const RectAngle<int>& area );
+    //! @brief 指定されたレイヤーの部分を再描写する
+    void Draw( unsigned int id );
+    //! @brief 指定されたレイヤーについて、areaで指定した部分(レイヤー左上基準)を再描写する
+    void Draw( unsigned int id, RectAngle<int> area );
+    //! @brief レイヤーの位置情報を指定された絶対座標へと更新し，移動前後の領域を再描写する
     void Move( LayerID id, Vector2<int> new_pos );
-    //! @brief レイヤーの位置情報を指定された双代座標へと更新する。再描写はしない
+    //! @brief レイヤーの位置情報を指定された双代座標へと更新し，移動前後の領域を再描写する
     void MoveRelative( LayerID id, Vector2<int> pos_diff );
 
+    //! @brief 画面座標で指定した領域を再描写が必要な領域に加える
+    void Invalidate( const RectAngle<int>& area );
+    //! @brief 記録された領域をまとめて合成し，画面へ転送する
+    void Flush();
+
+    /**
+     * @brief マウスカーソルの画像を設定する
+     *        カーソルはレイヤーとは別のオーバーレイで，常に最前面に描かれる
+     */
+    void SetCursor( const std::shared_ptr<Window>& image, Vector2<int> pos );
+    /**
+     * @brief カーソルを移動する
+     *        レイヤーの合成は行わず，元の位置の背景を復元して新しい位置にカーソルを描く
+     */
+    void MoveCursor( Vector2<int> pos );
+
     /**
      * @brief  レイヤーの高さ方向の位置を指定された位置に移動する
      * new_height に負の高さを指定するとレイヤーは非表示になり
@@ -98,9 +142,45 @@ private:
 
     using LayerPtr = std::unique_ptr<Layer>;
 
+    //! 不透明レイヤーに隠されていない領域の矩形数の上限 これを超えたら隠面の除去をやめる
+    static constexpr std::size_t k_MaxUncoveredRects = 64;
+
+    //! @brief area 内で各レイヤーが見えている矩形を m_VisibleRects に求める
+    void ComputeVisibleRects( const RectAngle<int>& area );
+    //! @brief カーソルの画面上の矩形
+    RectAngle<int> CursorArea() const;
+    //! @brief カーソル位置の背景にカーソルを重ねて画面へ転送する
+    void DrawCursor();
+    //! @brief m_LayerStack の [begin, end) にあるレイヤーの高さを振り直す
+    void RenumberHeights( int begin, int end );
+    //! @brief レイヤーの現在の位置と表示状態に合わせて m_Grid への登録を更新する
+    void Reindex( Layer* layer );
+
     FrameBuffer* m_Screen;
-    mutable FrameBuffer m_BackBuffer;
+    FrameBuffer m_BackBuffer;
+    //! 次の Flush で再描写する領域
+    Region m_Damage;
+    //! 表示中のレイヤーの空間索引
+    LayerGrid m_Grid;
+    //! m_Grid から引いたレイヤーの作業領域
+    std::vector<Layer*> m_Candidates;
+    //! ComputeVisibleRects の作業領域 (レイヤー, 見えている矩形) を上のレイヤーから順に並べる
+    std::vector<std::pair<const Layer*, RectAngle<int>>> m_VisibleRects;
+    std::vector<RectAngle<int>> m_Uncovered;
+    std::vector<RectAngle<int>> m_UncoveredNext;
+    //! 合成中のフレームの統計
+    gfxstat::FrameStats m_Frame;
+    //! 前のフレームを記録した時点の m_Screen への書き込みバイト数
+    uint64_t m_ScreenBytes;
+
+    //! カーソル画像 (透過色付き)
+    std::shared_ptr<Window> m_CursorImage;
+    Vector2<int> m_CursorPos;
+    //! カーソルを背景と重ねるための作業バッファ
+    FrameBuffer m_CursorBuffer;
+    //! 全てのレイヤー。ID をそのまま添字にするので先頭 (ID 0) は空
     std::vector<LayerPtr> m_Layers;
+    //! 表示中のレイヤーを下から順に並べたもの。添字が各レイヤーの高さと一致する
     std::vector<Layer*>   m_LayerStack;
     LayerID m_LatestID;
 };
@@ -109,31 +189,13 @@ class ActiveLayer
 {
 public:
     ActiveLayer( LayerManager& manager );
-    void SetMouseLayer( LayerID mouse_layer );
+    //! @brief 指定したレイヤーをアクティブにし，最前面に移動する
     void Activate( LayerID layer_id );
     LayerID GetActive() const { return m_ActiveLayer; }
 
 private:
     LayerManager& m_Manager;
     LayerID m_ActiveLayer;
-    LayerID m_MouseLayer;
 };
 
-constexpr Message MakeLayerMessage(
-    uint64_t task_id, LayerID layer_id, 
-    LayerOperation op, const RectAngle<int>& area )
-{
-    Message msg{ Message::k_Layer, task_id };
-
-    msg.Arg.Layer.LayerId = layer_id;
-    msg.Arg.Layer.op = op;
-    msg.Arg.Layer.x = area.pos.x;
-    msg.Arg.Layer.y = area.pos.y;
-    msg.Arg.Layer.w = area.size.x;
-    msg.Arg.Layer.h = area.size.y;
-
-    return msg;
-}
-
-void CreateLayer( const FrameBufferConfig& config, FrameBuffer* screen );
-void ProcessLayerMessage( const Message& msg );
\ No newline at end of file
+void CreateLayer( const FrameBufferConfig& config, FrameBuffer* screen );
\ No newline at end of file
@@ -0,0 +1,91 @@
+//
+// include files
+//
+#include "LayerGrid.hpp"
+
+#include <algorithm>
+
+//
+// funcion definitions
+//
+void LayerGrid::Initialize( Vector2<int> screen_size )
+{
+    constexpr int k_CellSize = 1 << k_CellShift;
+
+    m_Columns = (screen_size.x + k_CellSize - 1) >> k_CellShift;
+    m_Rows    = (screen_size.y + k_CellSize - 1) >> k_CellShift;
+    m_Cells.clear();
+    m_Cells.resize( m_Columns * m_Rows );
+}
+
+void LayerGrid::Insert( Layer* layer, const RectAngle<int>& area )
+{
+    Vector2<int> begin, end;
+    if( !CellRange( area, begin, end ) ){
+        return;
+    }
+
+    for( int y = begin.y; y < end.y; ++y ){
+        for( int x = begin.x; x < end.x; ++x ){
+            m_Cells[y * m_Columns + x].push_back( layer );
+        }
+    }
+}
+
+void LayerGrid::Remove( Layer* layer, const RectAngle<int>& area )
+{
+    Vector2<int> begin, end;
+    if( !CellRange( area, begin, end ) ){
+        return;
+    }
+
+    for( int y = begin.y; y < end.y; ++y ){
+        for( int x = begin.x; x < end.x; ++x ){
+            // セル内の順序は問わないので末尾と入れ替えて消す
+            auto& cell = m_Cells[y * m_Columns + x];
+            auto itr = std::find( cell.begin(), cell.end(), layer );
+            if( itr != cell.end() ){
+                *itr = cell.back();
+                cell.pop_back();
+            }
+        }
+    }
+}
+
+const std::vector<Layer*>* LayerGrid::At( Vector2<int> pos ) const
+{
+    const int x = pos.x >> k_CellShift;
+    const int y = pos.y >> k_CellShift;
+    if( pos.x < 0 || pos.y < 0 || x >= m_Columns || y >= m_Rows ){
+        return nullptr;
+    }
+    return &m_Cells[y * m_Columns + x];
+}
+
+void LayerGrid::Query( const RectAngle<int>& area, std::vector<Layer*>& out ) const
+{
+    Vector2<int> begin, end;
+    if( !CellRange( area, begin, end ) ){
+        return;
+    }
+
+    for( int y = begin.y; y < end.y; ++y ){
+        for( int x = begin.x; x < end.x; ++x ){
+            const auto& cell = m_Cells[y * m_Columns + x];
+            out.insert( out.end(), cell.begin(), cell.end() );
+        }
+    }
+}
+
+bool LayerGrid::CellRange( const RectAngle<int>& area, Vector2<int>& begin, Vector2<int>& end ) const
+{
+    if( area.size.x <= 0 || area.size.y <= 0 ){
+        return false;
+    }
+
+    const auto last = area.pos + area.size - Vector2<int>{1, 1};
+    begin = ElementMax( Vector2<int>{area.pos.x >> k_CellShift, area.pos.y >> k_CellShift}, Vector2<int>{0, 0} );
+    end   = ElementMin( Vector2<int>{(last.x >> k_CellShift) + 1, (last.y >> k_CellShift) + 1}, Vector2<int>{m_Columns, m_Rows} );
+
+    return begin.x < end.x && begin.y < end.y;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+//
+// include headers
+//
+#include <vector>
+
+#include "Graphic.hpp"
+
+class Layer;
+
+/**
+ * @brief 画面を一定の大きさのセルに分け，各セルに掛かる表示中のレイヤーを登録しておく
+ *        点や矩形に掛かるレイヤーを，全レイヤーを調べずに求めるために使う
+ *        登録・削除はレイヤーの矩形が掛かるセルの数だけの手間で済む
+ */
+class LayerGrid
+{
+public:
+    //! @brief セルの一辺の大きさ (2 の k_CellShift 乗ピクセル)
+    static constexpr int k_CellShift = 6;
+
+    LayerGrid() = default;
+
+    //! @brief 画面の大きさに合わせてセルを用意する。登録済みのレイヤーは全て外れる
+    void Initialize( Vector2<int> screen_size );
+
+    //! @brief area に掛かるセルに layer を登録する
+    void Insert( Layer* layer, const RectAngle<int>& area );
+    //! @brief Insert した時と同じ area を指定して登録を外す
+    void Remove( Layer* layer, const RectAngle<int>& area );
+
+    //! @brief pos を含むセルに登録されたレイヤー。画面外なら nullptr
+    const std::vector<Layer*>* At( Vector2<int> pos ) const;
+    //! @brief area に掛かるセルに登録されたレイヤーを out に追加する。重複して追加されることがある
+    void Query( const RectAngle<int>& area, std::vector<Layer*>& out ) const;
+
+private:
+
+    //! @brief area に掛かるセルの範囲 [begin, end) を求める。掛からなければ false
+    bool CellRange( const RectAngle<int>& area, Vector2<int>& begin, Vector2<int>& end ) const;
+
+    std::vector<std::vector<Layer*>> m_Cells;
+    int m_Columns = 0;
+    int m_Rows = 0;
+};
@@ -3,6 +3,9 @@
 // include files
 //
 #include "Mouse.hpp"
+
+#include <array>
+
 #include "MouseCursor.hpp"
 #include "usb/memory.hpp"
 #include "usb/device.hpp"
@@ -11,24 +14,102 @@
 #include "usb/xhci/trb.hpp"
 
 #include "Global.hpp"
+#include "InterruptGuard.hpp"
 //
 // constant
 //
-
+namespace
+{
+    //! 1 フレームの間に保持するボタン状態変化の数
+    constexpr int k_MaxButtonChanges = 8;
+}
 
 //
 // static variables
 //
+namespace
+{
+    //! @brief ボタンの状態変化と，その直前までの移動量
+    struct ButtonChange
+    {
+        Vector2<int> Motion;
+        uint8_t Buttons;
+    };
+
+    /**
+     * @brief まだ反映していないマウス入力
+     *        レポートを受けるワーカータスクが溜め，合成タスクが取り出す
+     *        どちらも割り込み禁止中に触る
+     */
+    struct PendingMouseInput
+    {
+        std::array<ButtonChange, k_MaxButtonChanges> Changes;
+        int ChangeCount;
+        //! 最後のボタン状態変化より後の移動量
+        Vector2<int> Motion;
+        uint8_t Buttons;
+    };
+
+    PendingMouseInput s_Pending;
+}
 
 //
 // static function declaration
 // 
+namespace
+{
+    void OnMouseReport( uint8_t buttons, int8_t displacement_x, int8_t displacement_y );
+}
 
 //
 // funcion definitions
 // 
+namespace
+{
+    void OnMouseReport( uint8_t buttons, int8_t displacement_x, int8_t displacement_y )
+    {
+        const Vector2<int> displacement{ displacement_x, displacement_y };
+
+        InterruptGuard guard;
+        if( buttons == s_Pending.Buttons ){
+            s_Pending.Motion += displacement;
+            return;
+        }
+
+        // 一杯なら最後の状態変化にまとめる (途中の押下・解放は失われる)
+        if( s_Pending.ChangeCount == k_MaxButtonChanges ){
+            auto& last = s_Pending.Changes[k_MaxButtonChanges - 1];
+            last.Motion += s_Pending.Motion + displacement;
+            last.Buttons = buttons;
+        }
+        else {
+            s_Pending.Changes[s_Pending.ChangeCount] = { s_Pending.Motion + displacement, buttons };
+            ++s_Pending.ChangeCount;
+        }
+        s_Pending.Motion = {0, 0};
+        s_Pending.Buttons = buttons;
+    }
+}
+
 void InitializeMouse()
 {
-    usb::HIDMouseDriver::default_observer = MouseObserver;
-    g_ActiveLayer->SetMouseLayer( g_MouseLayerID );
+    // レポートはワーカータスクで届くので、ここでは溜めるだけにして
+    // カーソル移動やドラッグは合成タスクがフレームごとにまとめて行う
+    usb::HIDMouseDriver::default_observer = OnMouseReport;
+}
+
+void ApplyMouseInput()
+{
+    InterruptGuard guard;
+    const PendingMouseInput input = s_Pending;
+    s_Pending.ChangeCount = 0;
+    s_Pending.Motion = {0, 0};
+    guard.Release();
+
+    for( int i = 0; i < input.ChangeCount; ++i ){
+        MouseObserver( input.Changes[i].Buttons, input.Changes[i].Motion );
+    }
+    if( input.Motion.x != 0 || input.Motion.y != 0 ){
+        MouseObserver( input.Buttons, input.Motion );
+    }
 }
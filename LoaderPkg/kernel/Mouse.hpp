@@ -3,3 +3,10 @@
 #include <cstdint>
 
 void InitializeMouse();
+
+/**
+ * @brief 前回呼ばれてから溜まったマウス入力をまとめてカーソル・レイヤーに反映する
+ *        合成タスクがフレームごとに呼ぶ
+ *        移動量は合算するが，ボタンの状態変化はその時点の位置で順に反映する
+ */
+void ApplyMouseInput();
@@ -4,6 +4,7 @@
 //
 #include "MouseCursor.hpp"
 #include "Global.hpp"
+#include "GfxStat.hpp"
 #include "logger.hpp"
 
 //
@@ -38,26 +39,27 @@ void MouseCursor::MoveRelative( Vector2<int> displacement )
     DrawMouseCursor( *m_PixelWriter, m_Position );
 }
 
-void MouseObserver( uint8_t buttons, int8_t displacement_x, int8_t displacement_y )
+void MouseObserver( uint8_t buttons, Vector2<int> displacement )
 {
     static unsigned int s_MouseDragLayerID = 0;
     static uint8_t s_PreviousButtons = 0;
 
     const auto oldpos = g_MousePosition;
 
-    auto newpos = g_MousePosition + Vector2<int>{ displacement_x, displacement_y };
+    auto newpos = g_MousePosition + displacement;
     newpos = ElementMin( newpos, g_ScreenSize + Vector2<int>{-1, -1} );
     g_MousePosition = ElementMax( newpos, Vector2<int>{0, 0} );
 
     const auto posdiff = g_MousePosition - oldpos;
 
-    g_LayerManager->Move( g_MouseLayerID, g_MousePosition );
+    g_LayerManager->MoveCursor( g_MousePosition );
 
     const bool previous_left_pressed = (s_PreviousButtons & 0x01);
     const bool left_pressed = (buttons & 0x01);
 
     if( !previous_left_pressed && left_pressed ){
-        auto layer = g_LayerManager->FindLayerByPosition( g_MousePosition, g_MouseLayerID );
+        // 統計のオーバーレイは表示するだけなので，下にあるウィンドウをクリックできるようにする
+        auto layer = g_LayerManager->FindLayerByPosition( g_MousePosition, gfxstat::HudLayerID() );
         if( layer && layer->IsDraggable() ){
             s_MouseDragLayerID = layer->ID();
             g_ActiveLayer->Activate(layer->ID());
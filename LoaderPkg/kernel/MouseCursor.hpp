@@ -21,4 +21,5 @@ inline static constexpr int k_MouseCursorWidth  = 15;
 inline static constexpr int k_MouseCursorHeight = 24;
 inline static constexpr PixelColor k_MouseTransparentColor = { 0, 0, 1 };
 
-void MouseObserver( uint8_t buttons, int8_t displacement_x, int8_t displacement_y );
+//! @brief マウスの入力をカーソル移動・レイヤー操作に反映する。合成タスクで呼ぶ
+void MouseObserver( uint8_t buttons, Vector2<int> displacement );
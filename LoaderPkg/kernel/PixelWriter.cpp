@@ -1,36 +1,79 @@
 #include "PixelWriter.hpp"
+#include "BlitKernel.hpp"
+#include <algorithm>
 
-static uint8_t* PixelAt( const FrameBufferConfig& config, uint32_t x, uint32_t y )
+void IPixelWriter::WriteSpan( int x, int y, const uint32_t* pixels, int n )
 {
-    return config.FrameBuffer + (4 * (config.PixelsPerScanLine * y + x));
+    const auto format = Format();
+    for( int i = 0; i < n; ++i ){
+        Write( x + i, y, UnpackPixel( format, pixels[i] ) );
+    }
 }
 
-RGB8BitPerColorPixelWriter::RGB8BitPerColorPixelWriter( const FrameBufferConfig& config )
-    : FrameBufferPixelWriter( config )
-{}
+void IPixelWriter::Blit( int x, int y, const uint32_t* src, int stride, int w, int h )
+{
+    for( int dy = 0; dy < h; ++dy ){
+        WriteSpan( x, y + dy, src + stride * dy, w );
+    }
+}
 
-void RGB8BitPerColorPixelWriter::Write( uint32_t x, uint32_t y, const PixelColor& c )
+void IPixelWriter::BlitTransparent( int x, int y, const uint32_t* src, int stride, int w, int h, uint32_t key )
 {
-    if( x < m_Config.HorizontalResolution && y < m_Config.VerticalResolution ){
-        uint8_t* p = PixelAt( m_Config, x, y );
-        p[0] = c.Red;
-        p[1] = c.Green;
-        p[2] = c.Blue;
+    const auto format = Format();
+    for( int dy = 0; dy < h; ++dy ){
+        for( int dx = 0; dx < w; ++dx ){
+            const uint32_t v = src[stride * dy + dx];
+            if( v != key ){
+                Write( x + dx, y + dy, UnpackPixel( format, v ) );
+            }
+        }
     }
 }
 
+void FrameBufferPixelWriter::FillRect( int x, int y, int w, int h, const PixelColor& c )
+{
+    FillNative( x, y, w, h, PackPixel( m_Config.PixelFormat, c ) );
+}
 
+void FrameBufferPixelWriter::FillNative( int x, int y, int w, int h, uint32_t value )
+{
+    const int x0 = std::max( x, 0 );
+    const int y0 = std::max( y, 0 );
+    const int x1 = std::min( x + w, Width() );
+    const int y1 = std::min( y + h, Height() );
 
-BGR8BitPerColorPixelWriter::BGR8BitPerColorPixelWriter( const FrameBufferConfig& config )
-    : FrameBufferPixelWriter( config )
-{}
+    for( int py = y0; py < y1; ++py ){
+        blit::FillRow( NativeAt( x0, py ), value, x1 - x0, false );
+    }
+}
 
-void BGR8BitPerColorPixelWriter::Write( uint32_t x, uint32_t y, const PixelColor& c )
+void FrameBufferPixelWriter::WriteSpan( int x, int y, const uint32_t* pixels, int n )
 {
-    if( x < m_Config.HorizontalResolution && y < m_Config.VerticalResolution ){
-        uint8_t* p = PixelAt( m_Config, x, y );
-        p[0] = c.Blue;
-        p[1] = c.Green;
-        p[2] = c.Red;
+    Blit( x, y, pixels, n, n, 1 );
+}
+
+void FrameBufferPixelWriter::Blit( int x, int y, const uint32_t* src, int stride, int w, int h )
+{
+    const int x0 = std::max( x, 0 );
+    const int y0 = std::max( y, 0 );
+    const int x1 = std::min( x + w, Width() );
+    const int y1 = std::min( y + h, Height() );
+
+    for( int py = y0; py < y1; ++py ){
+        blit::CopyRow( NativeAt( x0, py ),
+                       src + stride * (py - y) + (x0 - x), x1 - x0, false );
     }
-}
\ No newline at end of file
+}
+
+void FrameBufferPixelWriter::BlitTransparent( int x, int y, const uint32_t* src, int stride, int w, int h, uint32_t key )
+{
+    const int x0 = std::max( x, 0 );
+    const int y0 = std::max( y, 0 );
+    const int x1 = std::min( x + w, Width() );
+    const int y1 = std::min( y + h, Height() );
+
+    for( int py = y0; py < y1; ++py ){
+        blit::CopyRowKeyed( NativeAt( x0, py ),
+                            src + stride * (py - y) + (x0 - x), x1 - x0, key );
+    }
+}
@@ -23,8 +23,33 @@ public:
 
     virtual ~IPixelWriter() = default;
     virtual void Write( uint32_t x, uint32_t y, const PixelColor& c ) = 0;
+    //! @brief 矩形を塗りつぶす。既定の実装は Write を1ピクセルずつ呼ぶ
+    virtual void FillRect( int x, int y, int w, int h, const PixelColor& c )
+    {
+        for( int dy = 0; dy < h; ++dy ){
+            for( int dx = 0; dx < w; ++dx ){
+                Write( x + dx, y + dy, c );
+            }
+        }
+    }
+    /**
+     * @brief 1行分のピクセル列を書き込む
+     * @param pixels  Format() のネイティブ形式のピクセル列
+     * @param n       ピクセル数
+     */
+    virtual void WriteSpan( int x, int y, const uint32_t* pixels, int n );
+    /**
+     * @brief 矩形のピクセル列を書き込む
+     * @param src     Format() のネイティブ形式のピクセル列
+     * @param stride  src の1行あたりのピクセル数
+     */
+    virtual void Blit( int x, int y, const uint32_t* src, int stride, int w, int h );
+    //! @brief Blit と同じだが，値が key のピクセルは書き込まない
+    virtual void BlitTransparent( int x, int y, const uint32_t* src, int stride, int w, int h, uint32_t key );
     virtual int Width() const = 0;
     virtual int Height() const = 0;
+    //! @brief WriteSpan / Blit が受け取るピクセルの形式
+    virtual PixelFormat Format() const = 0;
 
 private:
 };
@@ -37,30 +62,94 @@ public:
 
     virtual int Width() const { return m_Config.HorizontalResolution; }
     virtual int Height() const { return m_Config.VerticalResolution; }
+    virtual PixelFormat Format() const { return m_Config.PixelFormat; }
+    virtual void FillRect( int x, int y, int w, int h, const PixelColor& c ) override;
+    virtual void WriteSpan( int x, int y, const uint32_t* pixels, int n ) override;
+    virtual void Blit( int x, int y, const uint32_t* src, int stride, int w, int h ) override;
+    virtual void BlitTransparent( int x, int y, const uint32_t* src, int stride, int w, int h, uint32_t key ) override;
 
 protected:
 
+    uint32_t* NativeAt( uint32_t x, uint32_t y ) const
+    {
+        return reinterpret_cast<uint32_t*>(m_Config.FrameBuffer) + (m_Config.PixelsPerScanLine * y + x);
+    }
+    //! @brief ネイティブ形式の値で矩形を塗りつぶす(クリップする)
+    void FillNative( int x, int y, int w, int h, uint32_t value );
+
     FrameBufferConfig m_Config;
 };
 
-class RGB8BitPerColorPixelWriter : public FrameBufferPixelWriter
+/**
+ * @brief ピクセル形式毎の色の詰め方
+ *        ネイティブ形式は 32bit 値で，メモリ上のバイト順がそのまま VRAM のバイト順になる(予約バイトは 0)
+ */
+template <PixelFormat Format>
+struct PixelFormatTraits;
+
+template <>
+struct PixelFormatTraits<kPixelRGBReserved8BitPerColor>
 {
-public:
-    RGB8BitPerColorPixelWriter( const FrameBufferConfig& config );
-    ~RGB8BitPerColorPixelWriter() = default;
+    static constexpr uint32_t Pack( const PixelColor& c )
+    {
+        return static_cast<uint32_t>(c.Red) |
+               (static_cast<uint32_t>(c.Green) << 8) |
+               (static_cast<uint32_t>(c.Blue) << 16);
+    }
+    static constexpr PixelColor Unpack( uint32_t v )
+    {
+        return { static_cast<uint8_t>(v & 0xff),
+                 static_cast<uint8_t>((v >> 8) & 0xff),
+                 static_cast<uint8_t>((v >> 16) & 0xff) };
+    }
+};
 
-    virtual void Write( uint32_t x, uint32_t y, const PixelColor& c ) override;
+template <>
+struct PixelFormatTraits<kPixelBGRReserved8BitPerColor>
+{
+    static constexpr uint32_t Pack( const PixelColor& c )
+    {
+        return static_cast<uint32_t>(c.Blue) |
+               (static_cast<uint32_t>(c.Green) << 8) |
+               (static_cast<uint32_t>(c.Red) << 16);
+    }
+    static constexpr PixelColor Unpack( uint32_t v )
+    {
+        return { static_cast<uint8_t>((v >> 16) & 0xff),
+                 static_cast<uint8_t>((v >> 8) & 0xff),
+                 static_cast<uint8_t>(v & 0xff) };
+    }
 };
 
-class BGR8BitPerColorPixelWriter : public FrameBufferPixelWriter
+/**
+ * @brief ピクセル形式をコンパイル時に固定した PixelWriter
+ *        形式の選択は FrameBuffer::Initialize などで1度だけ行う
+ */
+template <PixelFormat PF>
+class PixelWriter : public FrameBufferPixelWriter
 {
 public:
-    BGR8BitPerColorPixelWriter( const FrameBufferConfig& config );
-    ~BGR8BitPerColorPixelWriter() = default;
+    using Traits = PixelFormatTraits<PF>;
+
+    PixelWriter( const FrameBufferConfig& config ) : FrameBufferPixelWriter( config ) {}
+    ~PixelWriter() = default;
 
-    virtual void Write( uint32_t x, uint32_t y, const PixelColor& c ) override;
+    virtual void Write( uint32_t x, uint32_t y, const PixelColor& c ) override
+    {
+        if( x < m_Config.HorizontalResolution && y < m_Config.VerticalResolution ){
+            *NativeAt( x, y ) = Traits::Pack( c );
+        }
+    }
+    virtual void FillRect( int x, int y, int w, int h, const PixelColor& c ) override
+    {
+        FillNative( x, y, w, h, Traits::Pack( c ) );
+    }
+    virtual PixelFormat Format() const override { return PF; }
 };
 
+using RGB8BitPerColorPixelWriter = PixelWriter<kPixelRGBReserved8BitPerColor>;
+using BGR8BitPerColorPixelWriter = PixelWriter<kPixelBGRReserved8BitPerColor>;
+
 constexpr PixelColor ToColor(uint32_t c)
 {
     return {
@@ -68,3 +157,35 @@ constexpr PixelColor ToColor(uint32_t c)
         static_cast<uint8_t>((c >> 8) & 0xff),
         static_cast<uint8_t>(c & 0xff)};
 }
+
+//! @brief PixelColor をフレームバッファのネイティブな 32bit 表現に変換する
+constexpr uint32_t PackPixel( PixelFormat format, const PixelColor& c )
+{
+    if( format == kPixelRGBReserved8BitPerColor ){
+        return PixelFormatTraits<kPixelRGBReserved8BitPerColor>::Pack( c );
+    }
+    return PixelFormatTraits<kPixelBGRReserved8BitPerColor>::Pack( c );
+}
+
+/**
+ * @brief 不透明度 alpha (255 で不透明) の色を α 乗算済みのネイティブ表現に変換する
+ *        上位 8bit には透明度 (255 - alpha) を入れる
+ *        PackPixel の結果は上位 8bit が 0 なので，そのまま不透明な色として扱える
+ */
+constexpr uint32_t PackPremultiplied( PixelFormat format, const PixelColor& c, uint8_t alpha )
+{
+    const auto scale = [alpha]( uint8_t v ){
+        return static_cast<uint8_t>( (v * alpha + 127) / 255 );
+    };
+    const PixelColor premultiplied{ scale(c.Red), scale(c.Green), scale(c.Blue) };
+    return PackPixel( format, premultiplied ) | (static_cast<uint32_t>(255 - alpha) << 24);
+}
+
+//! @brief ネイティブな 32bit 表現を PixelColor に戻す
+constexpr PixelColor UnpackPixel( PixelFormat format, uint32_t v )
+{
+    if( format == kPixelRGBReserved8BitPerColor ){
+        return PixelFormatTraits<kPixelRGBReserved8BitPerColor>::Unpack( v );
+    }
+    return PixelFormatTraits<kPixelBGRReserved8BitPerColor>::Unpack( v );
+}
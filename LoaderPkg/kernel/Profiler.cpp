@@ -0,0 +1,137 @@
+//
+// include files
+//
+#include <algorithm>
+#include <atomic>
+#include <array>
+
+#include "Profiler.hpp"
+#include "KernelSymbol.hpp"
+#include "Task.hpp"
+#include "CPU.hpp"
+
+namespace profiler
+{
+//
+// static variables
+//
+namespace
+{
+    /**
+     * @brief CPU毎のサンプルバッファ
+     *        書き込みはそのCPUのタイマ割り込みのみなので、
+     *        書き込み位置を release で公開すればロック無しで読み出せる
+     */
+    struct SampleBuffer
+    {
+        std::array<Sample, k_SampleBufferSize> Samples;
+        std::atomic<uint32_t> Count;
+        std::atomic<uint32_t> Dropped;
+    };
+
+    std::array<SampleBuffer, k_MaxCPUs> s_Buffers;
+    std::atomic<bool> s_Running;
+}
+
+//
+// funcion definitions
+// 
+void Start()
+{
+    s_Running.store( false, std::memory_order_release );
+    for( auto& buf : s_Buffers ){
+        buf.Count.store( 0, std::memory_order_relaxed );
+        buf.Dropped.store( 0, std::memory_order_relaxed );
+    }
+    s_Running.store( true, std::memory_order_release );
+}
+
+void Stop()
+{
+    s_Running.store( false, std::memory_order_release );
+}
+
+bool IsRunning()
+{
+    return s_Running.load( std::memory_order_acquire );
+}
+
+void OnTimerInterrupt( const InterruptFrame& frame )
+{
+    if( !s_Running.load( std::memory_order_relaxed ) ){
+        return;
+    }
+
+    SampleBuffer& buf = s_Buffers[CurrentCPU()];
+    const uint32_t idx = buf.Count.load( std::memory_order_relaxed );
+    if( idx >= k_SampleBufferSize ){
+        buf.Dropped.fetch_add( 1, std::memory_order_relaxed );
+        return;
+    }
+
+    buf.Samples[idx].RIP = frame.rip;
+    buf.Samples[idx].TaskID = TaskManager::Instance().CurrentTask().ID();
+    buf.Count.store( idx + 1, std::memory_order_release );
+}
+
+std::size_t SampleCount()
+{
+    std::size_t count = 0;
+    for( const auto& buf : s_Buffers ){
+        count += buf.Count.load( std::memory_order_acquire );
+    }
+    return count;
+}
+
+std::size_t DroppedCount()
+{
+    std::size_t count = 0;
+    for( const auto& buf : s_Buffers ){
+        count += buf.Dropped.load( std::memory_order_relaxed );
+    }
+    return count;
+}
+
+void BuildHistogram( std::vector<HistogramEntry>& hist, bool by_symbol, uint64_t task_id )
+{
+    std::vector<HistogramEntry> keys;
+    keys.reserve( SampleCount() );
+
+    for( const auto& buf : s_Buffers ){
+        const uint32_t count = buf.Count.load( std::memory_order_acquire );
+        for( uint32_t i = 0; i < count; ++i ){
+            const Sample& s = buf.Samples[i];
+            if( task_id != 0 && s.TaskID != task_id ){
+                continue;
+            }
+
+            HistogramEntry e{ s.RIP, nullptr, 1 };
+            if( by_symbol ){
+                uint64_t start = 0;
+                e.Symbol = ksym::Lookup( s.RIP, &start );
+                if( e.Symbol ){
+                    e.Addr = start;
+                }
+            }
+            keys.push_back( e );
+        }
+    }
+
+    // 同じアドレスを集約する
+    std::sort( keys.begin(), keys.end(),
+               []( const auto& a, const auto& b ){ return a.Addr < b.Addr; } );
+    hist.clear();
+    for( const auto& e : keys ){
+        if( !hist.empty() && hist.back().Addr == e.Addr ){
+            ++hist.back().Count;
+        }
+        else {
+            hist.push_back( e );
+        }
+    }
+
+    std::sort( hist.begin(), hist.end(),
+               []( const auto& a, const auto& b ){ return a.Count > b.Count; } );
+}
+
+}
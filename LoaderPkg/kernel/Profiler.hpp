@@ -0,0 +1,63 @@
+#pragma once
+
+// 
+// include headers
+//
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "Interrupt.hpp"
+
+namespace profiler
+{
+//
+// constants
+//
+constexpr std::size_t k_SampleBufferSize = 16384;
+
+//
+// typedef structures
+//
+struct Sample
+{
+    uint64_t RIP;
+    uint64_t TaskID;
+};
+
+struct HistogramEntry
+{
+    uint64_t Addr;          //! シンボルの先頭アドレス、シンボルがなければサンプルのRIP
+    const char* Symbol;     //! シンボル名、シンボルがなければ nullptr
+    uint32_t Count;
+};
+
+// 
+// functions
+//
+//! @brief サンプリングを開始する。以前のサンプルは破棄する
+void Start();
+//! @brief サンプリングを停止する
+void Stop();
+bool IsRunning();
+
+/**
+ * @brief タイマ割り込みから呼び出され、割り込まれた RIP を記録する
+ *        割り込みハンドラ内で呼ぶ前提で、ロックは取らない
+ */
+void OnTimerInterrupt( const InterruptFrame& frame );
+
+//! @brief 記録済みのサンプル数
+std::size_t SampleCount();
+//! @brief バッファが満杯で捨てたサンプル数
+std::size_t DroppedCount();
+
+/**
+ * @brief 記録済みのサンプルからヒストグラムを作成する
+ * @param [out] hist     サンプル数の降順に並べたヒストグラム
+ * @param [in]  by_symbol true ならシンボル単位で集計する。シンボルが無ければ RIP 単位となる
+ * @param [in]  task_id   0 以外なら指定タスクのサンプルのみ集計する
+ */
+void BuildHistogram( std::vector<HistogramEntry>& hist, bool by_symbol, uint64_t task_id = 0 );
+
+}
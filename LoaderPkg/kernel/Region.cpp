@@ -0,0 +1,78 @@
+//
+// include files
+//
+#include "Region.hpp"
+
+#include <limits>
+
+//
+// static function declaration
+//
+namespace
+{
+    int64_t Area( const RectAngle<int>& r );
+    RectAngle<int> Union( const RectAngle<int>& a, const RectAngle<int>& b );
+}
+
+//
+// funcion definitions
+//
+namespace
+{
+    int64_t Area( const RectAngle<int>& r )
+    {
+        return static_cast<int64_t>(r.size.x) * r.size.y;
+    }
+
+    //! @brief a と b を両方含む最小の矩形
+    RectAngle<int> Union( const RectAngle<int>& a, const RectAngle<int>& b )
+    {
+        const auto pos = ElementMin( a.pos, b.pos );
+        const auto end = ElementMax( a.pos + a.size, b.pos + b.size );
+        return { pos, end - pos };
+    }
+}
+
+void Region::Add( const RectAngle<int>& rect )
+{
+    if( rect.size.x <= 0 || rect.size.y <= 0 ){
+        return;
+    }
+
+    // 併合しても面積が増えない(重なり分で無駄を相殺できる)矩形とは1つにまとめる
+    // まとめた結果さらに他の矩形と併合できることがあるので，併合がなくなるまで繰り返す
+    RectAngle<int> r = rect;
+    for( int i = 0; i < m_Count; ){
+        const auto u = Union( m_Rects[i], r );
+        if( Area(u) <= Area(m_Rects[i]) + Area(r) ){
+            r = u;
+            Remove( i );
+            i = 0;
+            continue;
+        }
+        ++i;
+    }
+
+    if( m_Count < k_MaxRects ){
+        m_Rects[m_Count++] = r;
+        return;
+    }
+
+    // 一杯なら面積の増加が最小になる矩形と併合する
+    int best = 0;
+    int64_t best_growth = std::numeric_limits<int64_t>::max();
+    for( int i = 0; i < m_Count; ++i ){
+        const int64_t growth = Area( Union( m_Rects[i], r ) ) - Area( m_Rects[i] );
+        if( growth < best_growth ){
+            best = i;
+            best_growth = growth;
+        }
+    }
+    m_Rects[best] = Union( m_Rects[best], r );
+}
+
+void Region::Remove( int index )
+{
+    m_Rects[index] = m_Rects[m_Count - 1];
+    --m_Count;
+}
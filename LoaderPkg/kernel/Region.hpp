@@ -0,0 +1,39 @@
+#pragma once
+
+//
+// include headers
+//
+#include <array>
+
+#include "Graphic.hpp"
+
+/**
+ * @brief 再描画が必要な領域(ダメージ)を矩形の集合として保持する
+ *        重なる・隣接する矩形は併合し，個数が上限を超えたら最も無駄の少ない組を併合する
+ */
+class Region
+{
+public:
+    //! @brief 保持する矩形数の上限
+    static constexpr int k_MaxRects = 16;
+
+    Region() = default;
+
+    //! @brief 矩形を追加する。大きさが 0 以下の矩形は無視する
+    void Add( const RectAngle<int>& rect );
+    //! @brief 全ての矩形を取り除く
+    void Clear() { m_Count = 0; }
+
+    bool Empty() const { return m_Count == 0; }
+    int Count() const { return m_Count; }
+
+    const RectAngle<int>* begin() const { return m_Rects.data(); }
+    const RectAngle<int>* end() const { return m_Rects.data() + m_Count; }
+
+private:
+
+    void Remove( int index );
+
+    std::array<RectAngle<int>, k_MaxRects> m_Rects;
+    int m_Count = 0;
+};
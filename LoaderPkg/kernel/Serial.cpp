@@ -0,0 +1,91 @@
+//
+// include files
+//
+#include "Serial.hpp"
+#include "asmfunc.h"
+
+namespace serial
+{
+//
+// constant
+//
+namespace
+{
+    constexpr uint16_t k_Data            = k_COM1 + 0;
+    constexpr uint16_t k_InterruptEnable = k_COM1 + 1;
+    constexpr uint16_t k_FIFOControl     = k_COM1 + 2;
+    constexpr uint16_t k_LineControl     = k_COM1 + 3;
+    constexpr uint16_t k_ModemControl    = k_COM1 + 4;
+    constexpr uint16_t k_LineStatus      = k_COM1 + 5;
+    constexpr uint16_t k_Scratch         = k_COM1 + 7;
+
+    constexpr uint8_t k_LineStatusTHRE = 0x20;     // 送信保持レジスタ空き
+}
+
+//
+// static variables
+//
+namespace
+{
+    bool s_Available = false;
+}
+
+//
+// funcion definitions
+// 
+void Initialize()
+{
+    // スクラッチレジスタで UART の存在を確認する
+    IoOut8( k_Scratch, 0x5A );
+    if( IoIn8( k_Scratch ) != 0x5A ){
+        s_Available = false;
+        return;
+    }
+
+    IoOut8( k_InterruptEnable, 0x00 );  // 割り込み禁止
+    IoOut8( k_LineControl, 0x80 );      // DLAB = 1
+    IoOut8( k_Data, 0x01 );             // 115200bps (divisor = 1)
+    IoOut8( k_InterruptEnable, 0x00 );
+    IoOut8( k_LineControl, 0x03 );      // 8bit, no parity, 1 stop bit
+    IoOut8( k_FIFOControl, 0xC7 );      // FIFO有効化、クリア
+    IoOut8( k_ModemControl, 0x03 );     // DTR, RTS
+
+    s_Available = true;
+}
+
+bool Available()
+{
+    return s_Available;
+}
+
+void Write( char c )
+{
+    if( !s_Available ){
+        return;
+    }
+
+    while( (IoIn8( k_LineStatus ) & k_LineStatusTHRE) == 0 ){
+    }
+    IoOut8( k_Data, static_cast<uint8_t>(c) );
+}
+
+void Write( const char* s )
+{
+    while( *s ){
+        if( *s == '\n' ){
+            Write( '\r' );
+        }
+        Write( *s );
+        ++s;
+    }
+}
+
+void Write( const void* buf, std::size_t len )
+{
+    const char* p = reinterpret_cast<const char*>(buf);
+    for( std::size_t i = 0; i < len; ++i ){
+        Write( p[i] );
+    }
+}
+
+}
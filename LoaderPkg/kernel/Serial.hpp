@@ -0,0 +1,28 @@
+#pragma once
+
+// 
+// include headers
+//
+#include <cstdint>
+#include <cstddef>
+
+namespace serial
+{
+//
+// constants
+//
+constexpr uint16_t k_COM1 = 0x3F8;
+
+// 
+// functions
+//
+//! @brief COM1 を 115200bps 8N1 で初期化する
+void Initialize();
+//! @brief シリアルポートが使用可能か
+bool Available();
+//! @brief 1バイト送信する。送信バッファが空くまでポーリングで待つ
+void Write( char c );
+void Write( const char* s );
+void Write( const void* buf, std::size_t len );
+
+}
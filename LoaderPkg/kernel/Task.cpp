@@ -5,6 +5,8 @@
 #include "Task.hpp"
 #include "Timer.hpp"
 #include "Segment.hpp"
+#include "Trace.hpp"
+#include "InterruptGuard.hpp"
 
 //
 // constant
@@ -51,7 +53,10 @@ Task::Task( uint64_t id )
       m_Context(),
       m_MsgQueue(),
       m_Level( k_DefaultLevel ),
-      m_Running( false )
+      m_Running( false ),
+      m_Stats{},
+      m_SwitchInTSC( 0 ),
+      m_RunnableTSC( 0 )
 {}
 
 Task& Task::InitContext( TaskFunc* f, int64_t data )
@@ -112,6 +117,7 @@ Task& Task::Wakeup()
 
 void Task::SendMessage( const Message& msg )
 {
+    TRACE( trace::k_SendMessage, m_ID, msg.Type );
     m_MsgQueue.push_back( msg );
     Wakeup();
 }
@@ -124,10 +130,17 @@ std::optional<Message> Task::ReceiveMessage()
 
     auto m = m_MsgQueue.front();
     m_MsgQueue.pop_front();
+    ++m_Stats.MessagesReceived;
+    TRACE( trace::k_ReceiveMessage, m.Type, m_MsgQueue.size() );
 
     return m;
 }
 
+const TaskStats& Task::Stats() const
+{
+    return m_Stats;
+}
+
 Task& Task::SetLevel( int level )
 {
     m_Level = level;
@@ -140,24 +153,53 @@ Task& Task::SetRunning( bool running )
     return *this;
 }
 
+void Task::OnSwitchIn( uint64_t tsc )
+{
+    m_Stats.WaitCycles += tsc - m_RunnableTSC;
+    m_SwitchInTSC = tsc;
+}
+
+void Task::OnSwitchOut( uint64_t tsc, bool voluntary )
+{
+    m_Stats.Cycles += tsc - m_SwitchInTSC;
+    if( voluntary ){
+        ++m_Stats.VoluntarySwitches;
+    }
+    else {
+        ++m_Stats.InvoluntarySwitches;
+        // ランキューに戻るので、ここから待ち時間となる
+        m_RunnableTSC = tsc;
+    }
+}
+
+void Task::OnRunnable( uint64_t tsc )
+{
+    m_RunnableTSC = tsc;
+}
+
 
 TaskManager::TaskManager()
     : m_Tasks(),
       m_LatestID( 0 ),
       m_Running(),
-      m_CurrentLevel( k_MaxLevel ),
+      m_CurrentLevel( k_MainTaskLevel ),
       m_LevelChanged( false )
 
 {
     Task& task = NewTask()
         .SetLevel( m_CurrentLevel )
         .SetRunning( true );
+    // 既に実行中なので，待ち時間 0 で切り替わったものとして計測を始める
+    const uint64_t tsc = ReadTSC();
+    task.OnRunnable( tsc );
+    task.OnSwitchIn( tsc );
     m_Running[m_CurrentLevel].push_back( &task );
 
     Task& idle = NewTask()
         .InitContext( TaskIdle, 0 )
         .SetLevel( 0 )
         .SetRunning( true );
+    idle.OnRunnable( tsc );
     m_Running[0].push_back( &idle );
 }
 
@@ -208,6 +250,17 @@ void TaskManager::SwitchTask( bool current_sleep )
     }
 
     Task* next_task = m_Running[m_CurrentLevel].front();
+    if( next_task == current_task ){
+        // 切り替え先がいない場合は、実行を継続する
+        return;
+    }
+
+    TRACE( trace::k_SwitchTask, current_task->ID(), next_task->ID() );
+
+    const uint64_t tsc = ReadTSC();
+    current_task->OnSwitchOut( tsc, current_sleep );
+    next_task->OnSwitchIn( tsc );
+    InterruptGuardOnSwitchTask( tsc );
 
     SwitchContext( &next_task->Context(), &current_task->Context() );
 }
@@ -253,6 +306,7 @@ void TaskManager::Wakeup( Task* task, int level )
 
     task->SetLevel( level );
     task->SetRunning( true );
+    task->OnRunnable( ReadTSC() );
 
     m_Running[level].push_back( task );
     if( level > m_CurrentLevel ){
@@ -286,6 +340,24 @@ Error TaskManager::SendMessage( uint64_t id, const Message& msg )
     return MAKE_ERROR( Error::kSuccess );
 }
 
+uint64_t TaskManager::Snapshot( std::vector<TaskInfo>& info )
+{
+    InterruptGuard guard;
+    const uint64_t tsc = ReadTSC();
+    const Task* current = &CurrentTask();
+
+    info.clear();
+    for( const auto& t : m_Tasks ){
+        TaskInfo ti{ t->ID(), t->Level(), t->Running(), t.get() == current, t->Stats() };
+        if( ti.Current ){
+            ti.Stats.Cycles += tsc - t->m_SwitchInTSC;
+        }
+        info.push_back( ti );
+    }
+
+    return tsc;
+}
+
 void TaskManager::ChangeLevelRunning( Task* task, int level )
 {
     if( level < 0 || level == task->Level() ){
@@ -318,9 +390,8 @@ void TaskManager::ChangeLevelRunning( Task* task, int level )
 
 void InitializeTask()
 {
-    __asm__("cli");
+    InterruptGuard guard;
     TimerManager::Instance().AddTimer( 
         Timer( k_TaskTimerPeriod, k_TaskTimerValue )
     );
-    __asm__("sti");
 }
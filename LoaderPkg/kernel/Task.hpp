@@ -23,6 +23,29 @@ struct TaskContext
 
 using TaskFunc = void( uint64_t, int64_t );
 
+/**
+ * @brief タスク毎のCPU使用統計
+ *        時間はすべて TSC のサイクル数で記録する
+ */
+struct TaskStats
+{
+    uint64_t Cycles;                //! 実行に使ったサイクル数
+    uint64_t WaitCycles;            //! 実行可能状態でランキューに待たされたサイクル数
+    uint64_t VoluntarySwitches;     //! 自らスリープしてCPUを手放した回数
+    uint64_t InvoluntarySwitches;   //! タイマによってCPUを取り上げられた回数
+    uint64_t MessagesReceived;      //! 受信したメッセージ数
+};
+
+//! @brief ps/top 表示用のタスク情報スナップショット
+struct TaskInfo
+{
+    uint64_t ID;
+    unsigned int Level;
+    bool Running;
+    bool Current;
+    TaskStats Stats;
+};
+
 class TaskManager;
 class Task
 {
@@ -43,12 +66,22 @@ public:
     void SendMessage( const Message& msg );
     std::optional<Message> ReceiveMessage();
 
+    //! @brief CPU使用統計を返す
+    const TaskStats& Stats() const;
+
 private:
 
     friend TaskManager;
     Task& SetLevel( int level );
     Task& SetRunning( bool running );
 
+    //! @brief CPU割り当て開始を記録する
+    void OnSwitchIn( uint64_t tsc );
+    //! @brief CPU割り当て終了を記録する
+    void OnSwitchOut( uint64_t tsc, bool voluntary );
+    //! @brief 実行可能状態になった時刻を記録する
+    void OnRunnable( uint64_t tsc );
+
     uint64_t m_ID;
     std::vector<uint64_t>   m_Stack;
     alignas(16) TaskContext m_Context;
@@ -56,13 +89,20 @@ private:
 
     unsigned int            m_Level;
     bool                    m_Running;
+
+    TaskStats               m_Stats;
+    uint64_t                m_SwitchInTSC;
+    uint64_t                m_RunnableTSC;
 };
 
 class TaskManager
 {
 public:
 
-    static constexpr int k_MaxLevel = 3;
+    //! 最上位のレベルは割り込みの後処理を行うワーカータスク用
+    static constexpr int k_MaxLevel = 4;
+    //! メインタスクの実行レベル (ワーカータスクより 1 つ下)
+    static constexpr int k_MainTaskLevel = k_MaxLevel - 1;
     static constexpr uint64_t k_MainTaskID = 1;
 public:
     
@@ -83,6 +123,14 @@ public:
 
     Error SendMessage( uint64_t id, const Message& msg );
 
+    /**
+     * @brief 全タスクの統計情報を取得する
+     *        現在実行中のタスクは呼び出し時点までの実行時間を含む
+     *        内部で割り込みを禁止するので、呼び出し側での排他は不要
+     * @return 取得時点の TSC 値
+     */
+    uint64_t Snapshot( std::vector<TaskInfo>& info );
+
 private:
 
     TaskManager();
@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "Terminal.hpp"
 #include "Global.hpp"
 #include "Setting.hpp"
@@ -6,6 +8,13 @@
 #include "Font.hpp"
 #include "Task.hpp"
 #include "FAT.hpp"
+#include "Timer.hpp"
+#include "Profiler.hpp"
+#include "Trace.hpp"
+#include "Serial.hpp"
+#include "InterruptGuard.hpp"
+#include "Compositor.hpp"
+#include "GfxStat.hpp"
 
 #include "driver/e1000e/e1000e.hpp"
 
@@ -25,6 +34,21 @@ const char* sk_BarDumpAddrSize[] = {
 
 uint8_t s_NetRxBuf[2048];
 
+constexpr int k_TopTimerValue = 0x746f70;   // 'top'
+constexpr int k_TopRefreshTicks = k_TimerFreq;
+constexpr int k_NetStatusTimerValue = 0x6e6574;   // 'net'
+constexpr int k_NetStatusTicks = k_TimerFreq;
+
+// スクロールバックを表示するキー (USB HID Usage ID)
+constexpr uint8_t k_KeyCodePageUp   = 0x4b;
+constexpr uint8_t k_KeyCodePageDown = 0x4e;
+
+//! セル属性ごとの文字色
+constexpr PixelColor k_AttrColors[] = {
+    {255, 255, 255},    // k_AttrOutput
+    k_TermCursorColor,  // k_AttrInput
+};
+
 //
 // static functions
 //
@@ -60,6 +84,201 @@ void DumpStatus( Terminal* term, driver::net::e1000e::Context* ctx )
     sprintf( s, "STATUS: %08X, FD:%d, LU:%d, SPEED:%d, RDBA:%08X%08X, RDLEN:%08X, RxInt:%u\n", status.Data, status.FD, status.LU, status.SPEED, rdbah.Data, rdbal.Data, rdlen.Data, g_e1000eRxIntCnt );
     term->Print(s);
 }
+
+uint64_t CyclesToMilliSeconds( uint64_t cycles )
+{
+    if( g_TSCFreq == 0 ){
+        return 0;
+    }
+    return cycles / (g_TSCFreq / 1000);
+}
+
+unsigned int Permille( uint64_t part, uint64_t whole )
+{
+    if( whole == 0 ){
+        return 0;
+    }
+    return static_cast<unsigned int>( part * 1000 / whole );
+}
+
+const TaskInfo* FindTaskInfo( const std::vector<TaskInfo>& info, uint64_t id )
+{
+    for( const auto& ti : info ){
+        if( ti.ID == id ){
+            return &ti;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * @brief プロファイラのヒストグラムを表示する
+ * @param raw  true ならシンボル解決せず RIP をそのまま表示する(addr2line 用)
+ */
+void DumpProfile( Terminal* term, bool raw, uint64_t task_id )
+{
+    constexpr std::size_t k_MaxLines = 32;
+    char s[128];
+
+    std::vector<profiler::HistogramEntry> hist;
+    profiler::BuildHistogram( hist, !raw, task_id );
+
+    const std::size_t total = profiler::SampleCount();
+    sprintf( s, "samples:%lu dropped:%lu %s\n", total, profiler::DroppedCount(),
+             profiler::IsRunning() ? "(running)" : "" );
+    term->Print( s );
+
+    // タスクを指定した場合は，そのタスクのサンプル数に対する割合を表示する
+    std::size_t whole = total;
+    if( task_id != 0 ){
+        whole = 0;
+        for( const auto& e : hist ){
+            whole += e.Count;
+        }
+        sprintf( s, "task %lu: %lu samples\n", task_id, whole );
+        term->Print( s );
+    }
+
+    for( std::size_t i = 0; i < hist.size() && i < k_MaxLines; ++i ){
+        const auto& e = hist[i];
+        const unsigned int pm = Permille( e.Count, whole );
+        if( e.Symbol ){
+            sprintf( s, "%6u %3u.%u%% %.40s\n", e.Count, pm / 10, pm % 10, e.Symbol );
+        }
+        else {
+            sprintf( s, "%6u %3u.%u%% 0x%016lx\n", e.Count, pm / 10, pm % 10, e.Addr );
+        }
+        term->Print( s );
+    }
+}
+
+//! @brief 割り込み禁止時間の長い呼び出し元を表示する
+void DumpInterruptMaskStats( Terminal* term )
+{
+    constexpr std::size_t k_MaxLines = 12;
+    char s[128];
+
+    std::vector<InterruptMaskSiteStats> sites;
+    GetInterruptMaskStats( sites );
+
+    term->Print( "   max(us)  avg(us)    count site\n" );
+    for( std::size_t i = 0; i < sites.size() && i < k_MaxLines; ++i ){
+        const auto& site = sites[i];
+        sprintf( s, "%10lu %8lu %8lu %.24s:%d\n",
+                 CyclesToMicroSeconds( site.MaxCycles ),
+                 CyclesToMicroSeconds( site.TotalCycles / site.Count ),
+                 site.Count, site.Function, site.Line );
+        term->Print( s );
+    }
+}
+
+//! @brief 割り込み禁止時間のヒストグラムを表示する
+void DumpInterruptMaskHistogram( Terminal* term )
+{
+    char s[128];
+    uint64_t hist[k_InterruptMaskHistogramBuckets];
+    GetInterruptMaskHistogram( hist );
+
+    term->Print( "  < cycles       < us    count\n" );
+    for( std::size_t i = 0; i < k_InterruptMaskHistogramBuckets; ++i ){
+        if( hist[i] == 0 ){
+            continue;
+        }
+        const uint64_t upper = 2ul << i;
+        sprintf( s, "%10lu %10lu %8lu\n", upper, CyclesToMicroSeconds( upper ), hist[i] );
+        term->Print( s );
+    }
+}
+
+//! @brief 画面合成の統計を表示する
+void DumpGfxStats( Terminal* term )
+{
+    char s[128];
+    gfxstat::Summary summary;
+    gfxstat::GetSummary( summary );
+
+    sprintf( s, "%lu frames, frame time(us) p50 %lu p90 %lu p99 %lu max %lu\n",
+             summary.Frames,
+             CyclesToMicroSeconds( summary.P50Cycles ), CyclesToMicroSeconds( summary.P90Cycles ),
+             CyclesToMicroSeconds( summary.P99Cycles ), CyclesToMicroSeconds( summary.MaxCycles ) );
+    term->Print( s );
+    if( summary.Frames == 0 ){
+        return;
+    }
+
+    const auto& last = summary.Last;
+    const auto& total = summary.Total;
+    const uint64_t n = summary.Frames;
+    term->Print( "          pixels      bytes draws layers rects\n" );
+    sprintf( s, "last %11lu %10lu %5u %6u %5u\n",
+             last.PixelsComposited, last.BytesToScreen, last.DrawCalls, last.LayersVisited, last.DamageRects );
+    term->Print( s );
+    sprintf( s, "avg  %11lu %10lu %5lu %6lu %5lu\n",
+             total.PixelsComposited / n, total.BytesToScreen / n,
+             static_cast<uint64_t>(total.DrawCalls) / n, static_cast<uint64_t>(total.LayersVisited) / n,
+             static_cast<uint64_t>(total.DamageRects) / n );
+    term->Print( s );
+}
+
+//! @brief 最新 n 件のトレースレコードを表示する
+void DumpTrace( Terminal* term, std::size_t n )
+{
+    char s[128];
+    trace::Record rec;
+
+    const std::size_t count = trace::Count();
+    const std::size_t begin = count > n ? count - n : 0;
+    for( std::size_t i = begin; i < count && trace::At( i, rec ); ++i ){
+        sprintf( s, "%12lu %3u %-11s %lx %lx\n", 
+                 rec.TSC, rec.TaskID, trace::EventName(rec.Type), rec.Arg0, rec.Arg1 );
+        term->Print( s );
+    }
+}
+
+/**
+ * @brief タスク統計を表示する
+ * @param prev  nullptr なら起動時からの累計を、そうでなければ prev からの差分を表示する
+ */
+void DumpTaskStats( Terminal* term, const std::vector<TaskInfo>& curr, 
+                    const std::vector<TaskInfo>* prev, uint64_t elapsed )
+{
+    char s[128];
+
+    if( prev ){
+        term->Print( " ID LV ST  CPU%  WAIT%    VSW    ISW    MSG\n" );
+    }
+    else {
+        term->Print( " ID LV ST  CPU(ms) WAIT(ms)      VSW      ISW      MSG\n" );
+    }
+
+    for( const auto& ti : curr ){
+        const char state = ti.Current ? 'R' : (ti.Running ? 'r' : 'S');
+        TaskStats st = ti.Stats;
+
+        if( prev ){
+            const TaskInfo* p = FindTaskInfo( *prev, ti.ID );
+            if( p ){
+                st.Cycles              -= p->Stats.Cycles;
+                st.WaitCycles          -= p->Stats.WaitCycles;
+                st.VoluntarySwitches   -= p->Stats.VoluntarySwitches;
+                st.InvoluntarySwitches -= p->Stats.InvoluntarySwitches;
+                st.MessagesReceived    -= p->Stats.MessagesReceived;
+            }
+            const unsigned int cpu  = Permille( st.Cycles, elapsed );
+            const unsigned int wait = Permille( st.WaitCycles, elapsed );
+            sprintf( s, "%3lu %2u  %c %3u.%u %4u.%u %6lu %6lu %6lu\n",
+                     ti.ID, ti.Level, state, cpu / 10, cpu % 10, wait / 10, wait % 10,
+                     st.VoluntarySwitches, st.InvoluntarySwitches, st.MessagesReceived );
+        }
+        else {
+            sprintf( s, "%3lu %2u  %c %8lu %8lu %8lu %8lu %8lu\n",
+                     ti.ID, ti.Level, state,
+                     CyclesToMilliSeconds(st.Cycles), CyclesToMilliSeconds(st.WaitCycles),
+                     st.VoluntarySwitches, st.InvoluntarySwitches, st.MessagesReceived );
+        }
+        term->Print(s);
+    }
+}
 }
 
 
@@ -76,25 +295,19 @@ void TerminalMessageDispacher::Register( LayerID layer_id, uint64_t task_id )
 
 void TerminalMessageDispacher::Unregister( LayerID layer_id )
 {
-    __asm__("cli");
+    InterruptGuard guard;
     auto itr = m_LayerTaskMap.find( layer_id );
-    __asm__("sti");
     if( itr != m_LayerTaskMap.end() ){
-        __asm__("cli");
         m_LayerTaskMap.erase( itr );
-        __asm__("sti");
     }
 }
 
 void TerminalMessageDispacher::Dispatch( LayerID layer_id, const Message& msg )
 {
-    __asm__("cli");
+    InterruptGuard guard;
     auto itr = m_LayerTaskMap.find( layer_id );
-    __asm__("sti");
     if( itr != m_LayerTaskMap.end() ){
-        __asm__("cli");
         TaskManager::Instance().SendMessage( itr->second, msg );
-        __asm__("sti");
     }
 }
 
@@ -103,10 +316,25 @@ Terminal::Terminal()
     : m_Window(),
       m_LayerID(0),
       m_Cursor{0, 0},
-      m_IsCursorVisible(false),
+      m_IsCursorVisible(true),
       m_LineBuf(),
-      m_LineBufIndex(0)
+      m_LineBufIndex(0),
+      m_Lines(),
+      m_TopLine(0),
+      m_HistoryLines(0),
+      m_ViewOffset(0),
+      m_DirtyCells{},
+      m_PendingScroll(0),
+      m_DrawnCursor{0, 0},
+      m_CursorDrawn(false),
+      m_Damage{{0, 0}, {0, 0}},
+      m_OutputBuf(),
+      m_OutputLen(0)
 {
+    for( auto& line : m_Lines ){
+        line.fill( Cell{' ', k_AttrOutput} );
+    }
+
     m_Window = std::make_shared<TopLevelWindow>(
         k_Columns * 8 + 8 + TopLevelWindow::k_MarginX,
         k_Rows * 16 + 8 + TopLevelWindow::k_MarginY,
@@ -133,45 +361,32 @@ Terminal::~Terminal()
     TerminalMessageDispacher::Instance().Unregister( m_LayerID );
 }
 
-void Terminal::DrawCursor( bool is_visible )
-{
-    const auto color = is_visible ? k_TermCursorColor : k_TermBackColor;
-    const auto pos = Vector2<int>{4 + 8*m_Cursor.x, 5 + 16*m_Cursor.y};
-    FillRectAngle(*(m_Window->InnerWriter()), pos, {7, 15}, color);
-}
-
-RectAngle<int> Terminal::InputKey(
+void Terminal::InputKey(
     uint8_t modifier, uint8_t keycode, char ascii
 )
 {
-    DrawCursor(false);
-
-    RectAngle<int> draw_area{ CalcCursorPos(), {8*2, 16} };
+    // 入力の反映より前に出力済みの文字をセルに書き込んでおく
+    ApplyOutput();
 
+    if( keycode == k_KeyCodePageUp ){
+        ScrollView( k_Rows / 2 );
+    }
+    else if( keycode == k_KeyCodePageDown ){
+        ScrollView( -(k_Rows / 2) );
+    }
     // 改行
-    if( ascii == '\n' ){
+    else if( ascii == '\n' ){
         m_LineBuf[m_LineBufIndex] = 0;
-        m_Cursor.x = 0;
         m_LineBufIndex = 0;
-        if( m_Cursor.y < (k_Rows - 1) ){
-            ++m_Cursor.y;
-        }
-        else {
-            ScrollLine();
-        }
+        NewLine();
 
         ExecuteLine();
         Print("#");
-
-        draw_area.pos  = TopLevelWindow::k_TopLeftMargin;
-        draw_area.size = m_Window->InnerSize(); 
     }
     else if( ascii == '\b' ){
         if( m_Cursor.x > 0 ){
             --m_Cursor.x;
-            FillRectAngle(*(m_Window->Writer()), CalcCursorPos(), {8, 16}, k_TermBackColor );
-            // カーソル位置再計算
-            draw_area.pos = CalcCursorPos();
+            SetCell( m_Cursor.y, m_Cursor.x, {' ', k_AttrOutput} );
             if( m_LineBufIndex > 0 ){
                 --m_LineBufIndex;
             }
@@ -181,106 +396,298 @@ RectAngle<int> Terminal::InputKey(
         if( m_Cursor.x < (k_Columns - 1) ){
             m_LineBuf[m_LineBufIndex] = ascii;
             ++m_LineBufIndex;
-            auto pos = CalcCursorPos();
-            WriteAscii(*(m_Window->Writer()), pos.x, pos.y, ascii, k_TermCursorColor );
+            SetCell( m_Cursor.y, m_Cursor.x, {ascii, k_AttrInput} );
             ++m_Cursor.x;
         }
     }
-
-    DrawCursor(true);
-
-    return draw_area;
 }
 
 void Terminal::Print( const char* s )
 {
-    DrawCursor( false );
-
-    auto newline = [this]() {
-        m_Cursor.x = 0;
-        if( m_Cursor.y < k_Rows - 1 ){
-            ++m_Cursor.y;
-        }
-        else {
-            ScrollLine();
+    while( *s ){
+        if( m_OutputLen == k_OutputBufferSize ){
+            Flush();
         }
-    };
+        m_OutputBuf[m_OutputLen] = *s;
+        ++m_OutputLen;
+        ++s;
+    }
+}
 
-    while( *s ){
-        if( *s == '\n' ){
-            newline();
+void Terminal::ApplyOutput()
+{
+    for( int i = 0; i < m_OutputLen; ++i ){
+        const char c = m_OutputBuf[i];
+        if( c == '\n' ){
+            NewLine();
         }
         else {
-            auto pos = CalcCursorPos();
-            WriteAscii( *(m_Window->Writer()), pos.x, pos.y, *s, {255, 255, 255} );
+            SetCell( m_Cursor.y, m_Cursor.x, {c, k_AttrOutput} );
             if( m_Cursor.x == k_Columns - 1 ){
-                newline();
+                NewLine();
             }
             else {
                 ++m_Cursor.x;
             }
         }
-        ++s;
     }
+    m_OutputLen = 0;
+}
+
+Terminal::Line& Terminal::LineAt( int row )
+{
+    const int index = (m_TopLine + row + k_ScrollbackLines) % k_ScrollbackLines;
+    return m_Lines[index];
+}
+
+void Terminal::SetCell( int row, int column, Cell cell )
+{
+    // 過去の行を表示中に書き込まれたら最新の表示に戻す
+    if( m_ViewOffset > 0 ){
+        ScrollView( -m_ViewOffset );
+    }
+
+    Cell& dst = LineAt( row )[column];
+    if( dst.Char == cell.Char && dst.Attr == cell.Attr ){
+        return;
+    }
+    dst = cell;
+    m_DirtyCells[row] |= 1ull << column;
+}
+
+void Terminal::NewLine()
+{
+    m_Cursor.x = 0;
+    if( m_Cursor.y < k_Rows - 1 ){
+        ++m_Cursor.y;
+        return;
+    }
+
+    if( m_ViewOffset > 0 ){
+        ScrollView( -m_ViewOffset );
+    }
+
+    // 最も古い行を新しい最下行として使う
+    m_TopLine = (m_TopLine + 1) % k_ScrollbackLines;
+    m_HistoryLines = std::min( m_HistoryLines + 1, k_ScrollbackLines - k_Rows );
+    LineAt( k_Rows - 1 ).fill( Cell{' ', k_AttrOutput} );
+
+    // ウィンドウの内容は Render でまとめて上へ移動するので，再描写フラグも合わせて移動する
+    for( int row = 0; row < k_Rows - 1; ++row ){
+        m_DirtyCells[row] = m_DirtyCells[row + 1];
+    }
+    m_DirtyCells[k_Rows - 1] = k_AllColumns;
+    if( m_PendingScroll < k_Rows ){
+        ++m_PendingScroll;
+    }
+    if( m_CursorDrawn && --m_DrawnCursor.y < 0 ){
+        m_CursorDrawn = false;
+    }
+}
+
+void Terminal::ScrollView( int lines )
+{
+    const int offset = std::clamp( m_ViewOffset + lines, 0, m_HistoryLines );
+    if( offset == m_ViewOffset ){
+        return;
+    }
+    m_ViewOffset = offset;
+    MarkAllDirty();
+}
 
-    DrawCursor( true );
+void Terminal::MarkAllDirty()
+{
+    m_DirtyCells.fill( k_AllColumns );
+    // 全て描き直すのでウィンドウ内容の移動は不要
+    m_PendingScroll = 0;
+    m_CursorDrawn = false;
 }
 
-Vector2<int> Terminal::CalcCursorPos()
+void Terminal::Render()
 {
-    return TopLevelWindow::k_TopLeftMargin + Vector2<int>{ 4 + 8*m_Cursor.x, 4 + 16*m_Cursor.y };
+    auto writer = m_Window->InnerWriter();
+
+    // カーソルの表示が変わるなら，消す位置と描く位置のセルを描き直す
+    const bool show_cursor = m_IsCursorVisible && m_ViewOffset == 0;
+    const bool cursor_moved = !m_CursorDrawn || m_DrawnCursor.x != m_Cursor.x || m_DrawnCursor.y != m_Cursor.y;
+    if( m_CursorDrawn && (!show_cursor || cursor_moved) ){
+        m_DirtyCells[m_DrawnCursor.y] |= 1ull << m_DrawnCursor.x;
+    }
+    if( show_cursor && cursor_moved ){
+        m_DirtyCells[m_Cursor.y] |= 1ull << m_Cursor.x;
+    }
+
+    if( m_PendingScroll > 0 ){
+        if( m_PendingScroll < k_Rows ){
+            const RectAngle<int> move_src{
+                TopLevelWindow::k_TopLeftMargin + Vector2<int>{4, 4 + 16 * m_PendingScroll},
+                {8 * k_Columns, 16 * (k_Rows - m_PendingScroll)}
+            };
+            m_Window->Move( TopLevelWindow::k_TopLeftMargin + Vector2<int>{4, 4}, move_src );
+        }
+        AddDamage( 0, 0, k_Rows, k_Columns );
+        m_PendingScroll = 0;
+    }
+
+    char s[k_Columns + 1];
+    for( int row = 0; row < k_Rows; ++row ){
+        uint64_t dirty = m_DirtyCells[row];
+        if( dirty == 0 ){
+            continue;
+        }
+        m_DirtyCells[row] = 0;
+
+        const Line& line = LineAt( row - m_ViewOffset );
+        while( dirty ){
+            // 連続する再描写対象のセルを，同じ属性ごとにまとめて描く
+            const int begin = __builtin_ctzll( dirty );
+            int end = begin;
+            while( end < k_Columns && (dirty & (1ull << end)) && line[end].Attr == line[begin].Attr ){
+                s[end - begin] = line[end].Char;
+                dirty &= ~(1ull << end);
+                ++end;
+            }
+            s[end - begin] = '\0';
+
+            WriteString( *writer, 4 + 8 * begin, 4 + 16 * row, s, k_AttrColors[line[begin].Attr], k_TermBackColor );
+            AddDamage( row, begin, 1, end - begin );
+        }
+    }
+
+    if( show_cursor ){
+        FillRectAngle( *writer, {4 + 8 * m_Cursor.x, 5 + 16 * m_Cursor.y}, {7, 15}, k_TermCursorColor );
+        m_DrawnCursor = m_Cursor;
+    }
+    m_CursorDrawn = show_cursor;
 }
 
-void Terminal::ScrollLine()
+void Terminal::AddDamage( int row, int column, int rows, int columns )
 {
-    RectAngle<int> move_src{
-        TopLevelWindow::k_TopLeftMargin + Vector2<int>{4, 4 + 16},
-        {8 * k_Columns, 16 * (k_Rows - 1)}
+    const RectAngle<int> area{
+        TopLevelWindow::k_TopLeftMargin + Vector2<int>{4 + 8 * column, 4 + 16 * row},
+        {8 * columns, 16 * rows}
     };
-    
-    m_Window->Move( TopLevelWindow::k_TopLeftMargin + Vector2<int>{4, 4}, move_src );
-    FillRectAngle(*(m_Window->InnerWriter()), {4, 4+(16*m_Cursor.y)}, {8*k_Columns, 16}, k_TermBackColor);
+    if( m_Damage.size.x <= 0 || m_Damage.size.y <= 0 ){
+        m_Damage = area;
+        return;
+    }
+    const auto pos = ElementMin( m_Damage.pos, area.pos );
+    const auto end = ElementMax( m_Damage.pos + m_Damage.size, area.pos + area.size );
+    m_Damage = {pos, end - pos};
+}
+
+RectAngle<int> Terminal::TakeDamage()
+{
+    const auto damage = m_Damage;
+    m_Damage = {{0, 0}, {0, 0}};
+    return damage;
+}
+
+void Terminal::Clear()
+{
+    // 消去される出力はセルに書き込むまでもない
+    m_OutputLen = 0;
+    for( int row = 0; row < k_Rows; ++row ){
+        for( int column = 0; column < k_Columns; ++column ){
+            SetCell( row, column, {' ', k_AttrOutput} );
+        }
+    }
+    m_Cursor.x = 0;
+    m_Cursor.y = 0;
+}
+
+void Terminal::Flush()
+{
+    ApplyOutput();
+    Render();
+    const auto damage = TakeDamage();
+    if( damage.size.x > 0 && damage.size.y > 0 ){
+        compositor::Draw( GetLayerID(), damage );
+    }
+}
+
+void Terminal::ShowTop()
+{
+    Task& task = TaskManager::Instance().CurrentTask();
+    std::vector<TaskInfo> prev, curr;
+
+    uint64_t prev_tsc = TaskManager::Instance().Snapshot( prev );
+
+    while(1){
+        {
+            InterruptGuard guard;
+            TimerManager::Instance().AddTimer( Timer(k_TopRefreshTicks, k_TopTimerValue, task.ID()) );
+        }
+
+        // 更新タイマかキー入力を待つ
+        std::optional<Message> msg;
+        while(1){
+            InterruptGuard guard;
+            msg = task.ReceiveMessage();
+            if( !msg ){
+                task.Sleep();
+                continue;
+            }
+            guard.Release();
+
+            if( msg->Type == Message::k_KeyPush ||
+                (msg->Type == Message::k_TimerTimeout && msg->Arg.Timer.Value == k_TopTimerValue) ){
+                break;
+            }
+        }
+
+        if( msg->Type == Message::k_KeyPush ){
+            break;
+        }
+
+        const uint64_t curr_tsc = TaskManager::Instance().Snapshot( curr );
+
+        char s[64];
+        Clear();
+        sprintf( s, "top - %u tasks, TSC %lu MHz (press any key)\n", 
+                 static_cast<unsigned int>(curr.size()), g_TSCFreq / 1000000 );
+        Print( s );
+        DumpTaskStats( this, curr, &prev, curr_tsc - prev_tsc );
+        Flush();
+
+        prev.swap( curr );
+        prev_tsc = curr_tsc;
+    }
 }
 
 void TaskTerminal( uint64_t task_id, int64_t data )
 {
-    __asm__("cli");
     Task& task = TaskManager::Instance().CurrentTask();
     Terminal* term = reinterpret_cast<Terminal*>(data);
-    g_LayerManager->Move(term->GetLayerID(), {100, 200});
-    g_ActiveLayer->Activate(term->GetLayerID());
-    __asm__("sti");
+    compositor::Move(term->GetLayerID(), {100, 200});
+    compositor::Activate(term->GetLayerID());
+    term->Flush();
 
 
     while(1){
-        __asm__("cli");
+        InterruptGuard guard;
 
         auto msg = task.ReceiveMessage();
         if( !msg ){
             task.Sleep();
-            __asm__("sti");
             continue;
         }
-        __asm__("sti");
+        guard.Release();
 
         switch( msg->Type ){
         case Message::k_KeyPush:
         {
-            const auto area = term->InputKey( msg->Arg.Keyboard.Key.Modifier(), 
-                                              msg->Arg.Keyboard.Key.KeyCode(),
-                                              msg->Arg.Keyboard.Key.Ascii() );
-            
-            Message msg = MakeLayerMessage(
-                task.ID(), term->GetLayerID(), LayerOperation::DrawArea, area
-            );
-            __asm__("cli");
-            TaskManager::Instance().SendMessage( 1, msg );
-            __asm__("sti");
+            term->InputKey( msg->Arg.Keyboard.Key.Modifier(), 
+                            msg->Arg.Keyboard.Key.KeyCode(),
+                            msg->Arg.Keyboard.Key.Ascii() );
         }
             break;
         default:
             break;
         }
+
+        // 1回のメッセージ処理で書き換えた分をまとめて画面に反映する
+        term->Flush();
     }
 }
 
@@ -303,8 +710,112 @@ void Terminal::ExecuteLine()
         Print("\n");
     }
     else if( strcmp(cmd, "clear") == 0 ){
-        FillRectAngle( *(m_Window->InnerWriter()), {4, 4}, {8 * k_Columns, 16*k_Rows}, {0, 0, 0} );
-        m_Cursor.y = 0;
+        Clear();
+    }
+    else if( strcmp(cmd, "ps") == 0 ){
+        std::vector<TaskInfo> info;
+        TaskManager::Instance().Snapshot( info );
+        DumpTaskStats( this, info, nullptr, 0 );
+    }
+    else if( strcmp(cmd, "top") == 0 ){
+        ShowTop();
+    }
+    else if( strcmp(cmd, "prof") == 0 ){
+        char* sub_arg = first_arg ? strchr( first_arg, ' ' ) : nullptr;
+        if( sub_arg ){
+            *sub_arg = '\0';
+            ++sub_arg;
+        }
+
+        if( first_arg && strcmp(first_arg, "start") == 0 ){
+            profiler::Start();
+            Print( "profiler started\n" );
+        }
+        else if( first_arg && strcmp(first_arg, "stop") == 0 ){
+            profiler::Stop();
+            Print( "profiler stopped\n" );
+        }
+        else if( first_arg && strcmp(first_arg, "dump") == 0 ){
+            const bool raw = sub_arg && strcmp(sub_arg, "raw") == 0;
+            const uint64_t task_id = (sub_arg && !raw) ? strtoul( sub_arg, nullptr, 0 ) : 0;
+            DumpProfile( this, raw, task_id );
+        }
+        else {
+            Print( "usage: prof start|stop|dump [raw|<task id>]\n" );
+        }
+    }
+    else if( strcmp(cmd, "trace") == 0 ){
+        char* sub_arg = first_arg ? strchr( first_arg, ' ' ) : nullptr;
+        if( sub_arg ){
+            *sub_arg = '\0';
+            ++sub_arg;
+        }
+
+        if( first_arg && strcmp(first_arg, "on") == 0 ){
+            const uint32_t mask = sub_arg ? strtoul( sub_arg, nullptr, 0 ) : 0xFFFFFFFFu;
+            trace::Enable( mask );
+            sprintf( s, "trace enabled mask=%08x\n", mask );
+            Print( s );
+        }
+        else if( first_arg && strcmp(first_arg, "off") == 0 ){
+            trace::Disable();
+            Print( "trace disabled\n" );
+        }
+        else if( first_arg && strcmp(first_arg, "show") == 0 ){
+            const std::size_t n = sub_arg ? strtoul( sub_arg, nullptr, 0 ) : k_Rows - 1;
+            DumpTrace( this, n );
+        }
+        else if( first_arg && strcmp(first_arg, "dump") == 0 ){
+            if( !serial::Available() ){
+                Print( "serial port not available\n" );
+                return;
+            }
+            sprintf( s, "dumping %lu records to serial\n", trace::Count() );
+            Print( s );
+            trace::DumpToSerial();
+        }
+        else {
+            Print( "usage: trace on [mask]|off|show [n]|dump\n" );
+        }
+    }
+    else if( strcmp(cmd, "irqstat") == 0 ){
+        if( first_arg && strcmp(first_arg, "hist") == 0 ){
+            DumpInterruptMaskHistogram( this );
+        }
+        else if( first_arg && strcmp(first_arg, "reset") == 0 ){
+            ResetInterruptMaskStats();
+        }
+        else {
+            DumpInterruptMaskStats( this );
+        }
+    }
+    else if( strcmp(cmd, "gfxstat") == 0 ){
+        char* sub_arg = first_arg ? strchr( first_arg, ' ' ) : nullptr;
+        if( sub_arg ){
+            *sub_arg = '\0';
+            ++sub_arg;
+        }
+
+        if( first_arg && strcmp(first_arg, "reset") == 0 ){
+            gfxstat::Reset();
+        }
+        else if( first_arg && strcmp(first_arg, "hud") == 0 ){
+            if( sub_arg && strcmp(sub_arg, "on") == 0 ){
+                gfxstat::SetHudVisible( true );
+            }
+            else if( sub_arg && strcmp(sub_arg, "off") == 0 ){
+                gfxstat::SetHudVisible( false );
+            }
+            else {
+                gfxstat::SetHudVisible( !gfxstat::IsHudVisible() );
+            }
+        }
+        else if( first_arg ){
+            Print( "usage: gfxstat [reset|hud [on|off]]\n" );
+        }
+        else {
+            DumpGfxStats( this );
+        }
     }
     else if( strcmp(cmd, "lspci") == 0 ){
         pci::ConfigurationArea& pciconf = pci::ConfigurationArea::Instance();
@@ -356,33 +867,44 @@ void Terminal::ExecuteLine()
             return;
         }
 
-        int count = 0;
+        // 受信割り込みでワーカータスクに起床してもらい、受信したフレームを表示する
+        driver::net::e1000e::SetRxTask( task.ID() );
+        {
+            InterruptGuard guard;
+            TimerManager::Instance().AddTimer( Timer(k_NetStatusTicks, k_NetStatusTimerValue, task.ID()) );
+        }
+
         while(1){
-            Task& task = TaskManager::Instance().CurrentTask();
+            // 受信の有無を調べてからスリープするまでの間に起床を取りこぼさないよう割り込みを止める
+            InterruptGuard guard;
             std::size_t len = g_e1000e_Ctx->Recv( s_NetRxBuf, sizeof(s_NetRxBuf) );
             if( len > 0 ){
+                guard.Release();
                 Print( "\n" );
                 DumpHex( this, s_NetRxBuf, len );
+                Flush();
+                continue;
             }
 
-            ++count;
-            //task.Sleep();
-            if( count >= 10000000 ){
-                DumpStatus( this, g_e1000e_Ctx );
-                RectAngle<int> draw_area{ CalcCursorPos(), {8*2, 16} };
-                draw_area.pos  = TopLevelWindow::k_TopLeftMargin;
-                draw_area.size = m_Window->InnerSize();
+            auto msg = task.ReceiveMessage();
+            if( !msg ){
+                task.Sleep();
+                continue;
+            }
+            guard.Release();
 
-                Message msg = MakeLayerMessage(
-                    task.ID(), this->GetLayerID(), LayerOperation::DrawArea, draw_area
-                );
-                __asm__("cli");
-                TaskManager::Instance().SendMessage( 1, msg );
-                __asm__("sti");
+            if( msg->Type == Message::k_KeyPush ){
+                break;
+            }
+            if( msg->Type == Message::k_TimerTimeout && msg->Arg.Timer.Value == k_NetStatusTimerValue ){
+                DumpStatus( this, g_e1000e_Ctx );
+                Flush();
 
-                count = 0;
+                InterruptGuard timer_guard;
+                TimerManager::Instance().AddTimer( Timer(k_NetStatusTicks, k_NetStatusTimerValue, task.ID()) );
             }
         }
+        driver::net::e1000e::SetRxTask( 0 );
     }
     else if( strcmp(cmd, "ls") == 0 ){
         auto root_dir_entries = g_AppVolume->GetSectorByCluster<fat::DirectoryEntry>( g_AppVolume->GetBPB()->RootCluster );
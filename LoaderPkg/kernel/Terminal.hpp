@@ -3,6 +3,7 @@
 #include <cstdint>
 #include <memory>
 #include <map>
+#include <array>
 #include "Window.hpp"
 #include "Type.hpp"
 #include "Event.hpp"
@@ -34,19 +35,68 @@ public:
     static constexpr int k_Rows = 15;
     static constexpr int k_Columns = 60;
     static constexpr int k_LineMax = 128;
+    //! 保持する行数 (画面に表示中の行を含む)
+    static constexpr int k_ScrollbackLines = 256;
+    //! まとめて画面に反映する出力の最大文字数
+    static constexpr int k_OutputBufferSize = 1024;
 
     Terminal();
     ~Terminal();
     LayerID GetLayerID() const { return m_LayerID; }
-    RectAngle<int> InputKey( uint8_t modifier, uint8_t keycode, char ascii );
+    //! @brief キー入力を処理する。画面への反映は Flush で行う
+    void InputKey( uint8_t modifier, uint8_t keycode, char ascii );
 
+    /**
+     * @brief 文字列を出力バッファに追加する
+     *        バッファが一杯になるか Flush が呼ばれるまでセルへは書き込まない
+     */
     void Print( const char* s );
+    /**
+     * @brief 溜まった出力をセルに書き込んで描き，
+     *        書き換えた領域を1つの矩形にまとめて合成タスクに再描写を要求する
+     */
+    void Flush();
 private:
 
-    void DrawCursor( bool is_visible );
-    Vector2<int> CalcCursorPos();
-    void ScrollLine();
+    //! @brief セルの表示属性
+    enum CellAttr : uint8_t
+    {
+        k_AttrOutput,   // コマンドの出力
+        k_AttrInput,    // 入力中の文字
+    };
+
+    //! @brief 画面の1文字分
+    struct Cell
+    {
+        char Char;
+        uint8_t Attr;
+    };
+    using Line = std::array<Cell, k_Columns>;
+
+    // 列ごとの再描写フラグを 1 行 1 ワードで持つ
+    static_assert( k_Columns <= 64 );
+    static constexpr uint64_t k_AllColumns = (k_Columns == 64) ? ~0ull : ((1ull << k_Columns) - 1);
+
+    //! @brief 出力バッファの内容をセルに書き込む
+    void ApplyOutput();
+    //! @brief row 行目 (0 が画面の最上行，負ならスクロールバック) の行を返す
+    Line& LineAt( int row );
+    //! @brief セルを書き換え，内容が変わったら再描写対象にする
+    void SetCell( int row, int column, Cell cell );
+    //! @brief カーソルを次の行の先頭に移す。最下行なら 1 行スクロールする
+    void NewLine();
+    //! @brief 表示位置を lines 行だけ過去に戻す (負なら最新側に進める)
+    void ScrollView( int lines );
+    void MarkAllDirty();
+    //! @brief 再描写対象のセルだけをウィンドウに描き，描いた領域を m_Damage に加える
+    void Render();
+    //! @brief 描いた領域を取り出してクリアする
+    RectAngle<int> TakeDamage();
+    void AddDamage( int row, int column, int rows, int columns );
+
     void ExecuteLine();
+    void Clear();
+    void ShowTop();
 
     std::shared_ptr<TopLevelWindow> m_Window;
     LayerID m_LayerID;
@@ -56,6 +106,27 @@ private:
     std::array<char, k_LineMax> m_LineBuf;
     int m_LineBufIndex;
 
+    //! スクロールバックを含む全ての行 (リングバッファ)
+    std::array<Line, k_ScrollbackLines> m_Lines;
+    //! 画面の最上行の m_Lines 上の位置
+    int m_TopLine;
+    //! 画面より上に残っている行数
+    int m_HistoryLines;
+    //! 最新の表示位置から何行過去を表示しているか
+    int m_ViewOffset;
+    //! 再描写が必要なセル (画面の行ごと，ビット i が i 列目)
+    std::array<uint64_t, k_Rows> m_DirtyCells;
+    //! 次の Render でウィンドウの内容を上へ移動する行数
+    int m_PendingScroll;
+    //! 最後に描いたカーソルの位置 (m_CursorDrawn が true の時のみ有効)
+    Vector2<int> m_DrawnCursor;
+    bool m_CursorDrawn;
+    //! Render で描いたウィンドウ上の領域
+    RectAngle<int> m_Damage;
+    //! まだセルに書き込んでいない出力
+    std::array<char, k_OutputBufferSize> m_OutputBuf;
+    int m_OutputLen;
+
     uint64_t m_TaskID;
 };
 
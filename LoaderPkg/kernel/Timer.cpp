@@ -8,6 +8,8 @@
 #include "Global.hpp"
 #include "Task.hpp"
 #include "Event.hpp"
+#include "asmfunc.h"
+#include "InterruptGuard.hpp"
 
 //
 // constant
@@ -36,16 +38,18 @@ TimerManager* TimerManager::s_Instance = nullptr;
 // funcion definitions
 // 
 
-Timer::Timer( uint32_t timeout, int value )
+Timer::Timer( uint32_t timeout, int value, uint64_t task_id )
     : m_Timeout( 0 ),
-      m_Value( value )
+      m_Value( value ),
+      m_TaskID( task_id )
 {
     m_Timeout = TimerManager::Instance().CurrentTick() + timeout;
 }
 
 Timer::Timer()
     : m_Timeout( std::numeric_limits<uint64_t>::max() ),
-      m_Value( 0 )
+      m_Value( 0 ),
+      m_TaskID( TaskManager::k_MainTaskID )
 {}
 
 uint64_t Timer::Timeout() const
@@ -58,6 +62,11 @@ int Timer::Value() const
     return m_Value;
 }
 
+uint64_t Timer::TaskID() const
+{
+    return m_TaskID;
+}
+
 bool Timer::operator<( const Timer& rhs ) const
 {
     return this->Timeout() > rhs.Timeout();
@@ -105,9 +114,9 @@ bool TimerManager::Tick()
             m_Timers.push( Timer( k_TaskTimerPeriod, k_TaskTimerValue ) );
             continue;
         }
-        Message m{ Message::k_TimerTimeout, TaskManager::k_MainTaskID };
+        Message m{ Message::k_TimerTimeout, t.TaskID() };
         m.Arg.Timer.Value = t.Value();
-        TaskManager::Instance().SendMessage( TaskManager::k_MainTaskID, m );
+        TaskManager::Instance().SendMessage( t.TaskID(), m );
 
         m_Timers.pop();
     }
@@ -117,13 +126,8 @@ bool TimerManager::Tick()
 
 uint64_t TimerManager::CurrentTick() const
 {
-    uint64_t tick = 0;
-
-    __asm__("cli");
-    tick = m_Tick;
-    __asm__("sti");
-
-    return tick;
+    InterruptGuard guard;
+    return m_Tick;
 }
 
 void TimerManager::AddTimer( const Timer& timer )
@@ -137,13 +141,16 @@ void InitializeLAPICTimer()
     *divide_config = 0b1011;    // divide 1:1
     *lvt_timer = 0b001 << 16;   // masked, one-shot
 
+    const uint64_t tsc_start = ReadTSC();
     StartLAPICTimer();
     acpi::WaitMillSeconds( 100 );
     const auto elapsed = LAPICTimerElapsed();    
     StopLAPICTimer();
+    const uint64_t tsc_elapsed = ReadTSC() - tsc_start;
 
     // 1秒経過時間を計算
     g_LApicTimerFreq = static_cast<unsigned long>(elapsed) * 10;
+    g_TSCFreq = tsc_elapsed * 10;
 
     // 10ms 毎に割り込み発生となるように設定
     *divide_config = 0b1011;    // divide 1:1
@@ -151,6 +158,14 @@ void InitializeLAPICTimer()
     *initial_count = g_LApicTimerFreq / k_TimerFreq;
 }
 
+uint64_t CyclesToMicroSeconds( uint64_t cycles )
+{
+    if( g_TSCFreq < 1000000 ){
+        return 0;
+    }
+    return cycles / (g_TSCFreq / 1000000);
+}
+
 void StartLAPICTimer()
 {
     *initial_count = k_MaxCount;
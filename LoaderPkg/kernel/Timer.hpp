@@ -8,6 +8,7 @@
 #include <queue>
 
 #include "Event.hpp"
+#include "Task.hpp"
 
 
 //
@@ -21,10 +22,12 @@ class Timer
 {
 public:
     
-    Timer( uint32_t timeout, int value );
+    Timer( uint32_t timeout, int value, uint64_t task_id = TaskManager::k_MainTaskID );
 
     uint64_t Timeout() const;
     int Value() const;
+    //! @brief タイムアウト時にメッセージを通知するタスクID
+    uint64_t TaskID() const;
 
     bool operator<( const Timer& rhs ) const;
 
@@ -36,6 +39,7 @@ private:
 
     uint64_t m_Timeout;
     int m_Value;
+    uint64_t m_TaskID;
 };
 
 class TimerManager
@@ -64,6 +68,8 @@ private:
 };
 
 void InitializeLAPICTimer();
+//! @brief TSC のサイクル数をマイクロ秒に換算する (InitializeLAPICTimer で g_TSCFreq を計測する前は 0)
+uint64_t CyclesToMicroSeconds( uint64_t cycles );
 void StartLAPICTimer();
 uint32_t LAPICTimerElapsed();
 void StopLAPICTimer();
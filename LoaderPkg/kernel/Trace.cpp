@@ -0,0 +1,134 @@
+//
+// include files
+//
+#include <array>
+#include <atomic>
+#include <cstdio>
+
+#include "Trace.hpp"
+#include "Task.hpp"
+#include "Serial.hpp"
+#include "CPU.hpp"
+#include "asmfunc.h"
+
+namespace trace
+{
+//
+// static variables
+//
+namespace
+{
+    /**
+     * @brief CPU毎のリングバッファ
+     *        書き込み位置は fetch_add で予約するので、
+     *        タスクと割り込みハンドラが同時に書き込んでもロックは不要
+     *        一周したら古いレコードから上書きする
+     */
+    struct Ring
+    {
+        std::array<Record, k_RingSize> Records;
+        std::atomic<uint64_t> Head;
+    };
+
+    std::array<Ring, k_MaxCPUs> s_Rings;
+
+    const char* sk_EventNames[] = {
+        "int_entry",
+        "int_exit",
+        "switch_task",
+        "send_msg",
+        "recv_msg",
+        "layer_draw",
+        "xhci_event",
+        "e1000e_int",
+    };
+    static_assert( sizeof(sk_EventNames) / sizeof(sk_EventNames[0]) == k_EventTypeNum );
+}
+
+volatile uint32_t g_EnabledMask = 0;
+
+//
+// funcion definitions
+// 
+void Enable( uint32_t mask )
+{
+    g_EnabledMask = 0;
+    for( auto& ring : s_Rings ){
+        ring.Head.store( 0, std::memory_order_relaxed );
+    }
+    g_EnabledMask = mask;
+}
+
+void Disable()
+{
+    g_EnabledMask = 0;
+}
+
+__attribute__((noinline))
+void Write( EventType type, uint64_t arg0, uint64_t arg1 )
+{
+    const uint32_t cpu = CurrentCPU();
+    Ring& ring = s_Rings[cpu];
+    const uint64_t head = ring.Head.fetch_add( 1, std::memory_order_relaxed );
+
+    Record& rec = ring.Records[head & (k_RingSize - 1)];
+    rec.TSC    = ReadTSC();
+    rec.CPU    = cpu;
+    rec.Type   = type;
+    rec.TaskID = TaskManager::Instance().CurrentTask().ID();
+    rec.Arg0   = arg0;
+    rec.Arg1   = arg1;
+}
+
+std::size_t Count()
+{
+    std::size_t count = 0;
+    for( const auto& ring : s_Rings ){
+        const uint64_t head = ring.Head.load( std::memory_order_acquire );
+        count += head < k_RingSize ? head : k_RingSize;
+    }
+    return count;
+}
+
+bool At( std::size_t index, Record& rec )
+{
+    for( const auto& ring : s_Rings ){
+        const uint64_t head = ring.Head.load( std::memory_order_acquire );
+        const std::size_t count = head < k_RingSize ? head : k_RingSize;
+        if( index < count ){
+            rec = ring.Records[(head - count + index) & (k_RingSize - 1)];
+            return true;
+        }
+        index -= count;
+    }
+    return false;
+}
+
+const char* EventName( uint16_t type )
+{
+    if( type >= k_EventTypeNum ){
+        return "unknown";
+    }
+    return sk_EventNames[type];
+}
+
+void DumpToSerial()
+{
+    char s[128];
+    Record rec;
+
+    // 出力中に記録が進まないよう止めておく
+    const uint32_t mask = g_EnabledMask;
+    g_EnabledMask = 0;
+
+    serial::Write( "# tsc cpu task event arg0 arg1\n" );
+    for( std::size_t i = 0; At( i, rec ); ++i ){
+        sprintf( s, "%lu %u %u %s 0x%lx 0x%lx\n", 
+                 rec.TSC, rec.CPU, rec.TaskID, EventName(rec.Type), rec.Arg0, rec.Arg1 );
+        serial::Write( s );
+    }
+
+    g_EnabledMask = mask;
+}
+
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+// 
+// include headers
+//
+#include <cstdint>
+#include <cstddef>
+
+namespace trace
+{
+//
+// constants
+//
+//! @brief CPU毎のリングバッファのレコード数(2のべき乗)
+constexpr std::size_t k_RingSize = 8192;
+static_assert( (k_RingSize & (k_RingSize - 1)) == 0, "k_RingSize must be power of 2" );
+
+enum EventType : uint16_t {
+    k_IntEntry,         //! Arg0: 割り込みベクタ
+    k_IntExit,          //! Arg0: 割り込みベクタ
+    k_SwitchTask,       //! Arg0: 切り替え元タスクID, Arg1: 切り替え先タスクID
+    k_SendMessage,      //! Arg0: 宛先タスクID, Arg1: メッセージ種別
+    k_ReceiveMessage,   //! Arg0: メッセージ種別, Arg1: 残りキュー長
+    k_LayerDraw,        //! Arg0: レイヤID(0なら全レイヤ), Arg1: PackRect() した描画領域
+    k_XHCIEvent,        //! Arg0: TRB種別
+    k_E1000EInterrupt,  //! Arg0: ICR
+    k_EventTypeNum,
+};
+
+//
+// typedef structures
+//
+struct Record
+{
+    uint64_t TSC;
+    uint16_t CPU;
+    uint16_t Type;
+    uint32_t TaskID;
+    uint64_t Arg0;
+    uint64_t Arg1;
+};
+static_assert( sizeof(Record) == 32 );
+
+//
+// variables
+//
+/**
+ * @brief 有効なイベント種別のビットマスク
+ *        トレースポイントはこの値を1回読んで分岐するだけなので、
+ *        無効時のコストはほぼ予測成功する分岐1回分となる
+ */
+extern volatile uint32_t g_EnabledMask;
+
+// 
+// functions
+//
+//! @brief mask で指定したイベント種別を有効化する。以前の記録は破棄する
+void Enable( uint32_t mask );
+void Disable();
+
+//! @brief レコードを書き込む。TRACE マクロから呼ばれる
+void Write( EventType type, uint64_t arg0, uint64_t arg1 );
+
+//! @brief 記録済みのレコード数(リングが一周していればリングサイズ)
+std::size_t Count();
+
+/**
+ * @brief 記録済みのレコードを古い順に取り出す
+ * @param [in]  index   0 が最も古いレコード
+ * @param [out] rec     取り出したレコード
+ * @return index が範囲外なら false
+ */
+bool At( std::size_t index, Record& rec );
+
+//! @brief イベント種別の名前を返す
+const char* EventName( uint16_t type );
+
+//! @brief 記録済みのレコードをテキスト形式でシリアルポートに出力する
+void DumpToSerial();
+
+//! @brief 描画領域を Arg に詰める
+constexpr uint64_t PackRect( int x, int y, int w, int h )
+{
+    return (static_cast<uint64_t>(static_cast<uint16_t>(x)) << 48) |
+           (static_cast<uint64_t>(static_cast<uint16_t>(y)) << 32) |
+           (static_cast<uint64_t>(static_cast<uint16_t>(w)) << 16) |
+           (static_cast<uint64_t>(static_cast<uint16_t>(h)));
+}
+
+}
+
+/**
+ * @brief トレースポイント
+ *        無効時は引数の評価も行わない
+ */
+#define TRACE( type, arg0, arg1 ) \
+    do { \
+        if( __builtin_expect( trace::g_EnabledMask & (1u << (type)), 0 ) ){ \
+            trace::Write( (type), (arg0), (arg1) ); \
+        } \
+    } while( 0 )
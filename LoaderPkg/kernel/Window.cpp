@@ -5,6 +5,7 @@
 #include "Font.hpp"
 #include "logger.hpp"
 #include "PixelWriter.hpp"
+#include "BlitKernel.hpp"
 
 //
 // constant
@@ -62,101 +63,177 @@ namespace
 // funcion definitions
 //
 
-Window::Window(int width, int height, PixelFormat shadow_format)
+Window::Window(int width, int height, PixelFormat format)
     : m_Width(width),
       m_Height(height),
-      m_Data(),
       m_Writer(*this),
-      m_TransparentColor(),
-      m_ShadowBuffer()
+      m_TransparentKey(),
+      m_AlphaBlending(false),
+      m_Spans(),
+      m_SpanRowStart(),
+      m_SpansDirty(true),
+      m_Surface()
 {
-    m_Data.resize(m_Height);
-
-    for( int y = 0; y < m_Height; ++y ){
-        m_Data[y].resize(m_Width);
-    }
-
     FrameBufferConfig config;
     config.FrameBuffer = nullptr;
     config.HorizontalResolution = width;
     config.VerticalResolution = height;
-    config.PixelFormat = shadow_format;
+    config.PixelFormat = format;
 
-    auto err = m_ShadowBuffer.Initialize(config);
+    auto err = m_Surface.Initialize(config);
     if( err ){
-        Log(kError, "failed to initialize shadow buffer : %s at %s:%d\n",
+        Log(kError, "failed to initialize window surface : %s at %s:%d\n",
             err.Name(), err.File(), err.Line());
     }
 }
 
 void Window::DrawTo(FrameBuffer &dst, Vector2<int> pos, const RectAngle<int> &area)
 {
-    if (!m_TransparentColor)
-    {
-        RectAngle<int> window_area{pos, Size()};
-        RectAngle<int> intersection = area.Intersection(window_area);
-        // Copy の第3引数にはバッファの左上座標を基準とする座標を渡す必要がある
-        // pos は バッファの左上座標を基準とするウィンドウ位置が入っているので
-        // intersecton - pos とすれば、交差した矩形の左上がバッファの左上座標からどこにあるか
-        // 計算できることになる
-        dst.Copy(intersection.pos, m_ShadowBuffer, {intersection.pos - pos, intersection.size});
+    RectAngle<int> window_area{pos, Size()};
+    RectAngle<int> intersection = area.Intersection(window_area);
+    // Copy の第3引数にはバッファの左上座標を基準とする座標を渡す必要がある
+    // pos は バッファの左上座標を基準とするウィンドウ位置が入っているので
+    // intersecton - pos とすれば、交差した矩形の左上がバッファの左上座標からどこにあるか
+    // 計算できることになる
+    const RectAngle<int> src_area{intersection.pos - pos, intersection.size};
+
+    if( m_AlphaBlending ){
+        dst.CopyBlend(intersection.pos, m_Surface, src_area);
     }
-    else
-    {
-        const auto tc = m_TransparentColor.value();
-        auto &dst_w = dst.Writer();
-        for (int y = std::max(0, 0 - pos.y); 
-             y < std::min(Height(), dst_w.Height() - pos.y); ++y)
-        {
-            for (int x = std::max(0, 0 - pos.x); 
-                 x < std::min(Width(), dst_w.Width() - pos.x); ++x)
-            {
-                const auto c = At(x, y);
-                if (tc != c)
-                {
-                    dst_w.Write(pos.x + x, pos.y + y, c);
-                }
-            }
-        }
+    else if( !m_TransparentKey ){
+        dst.Copy(intersection.pos, m_Surface, src_area);
+    }
+    else {
+        DrawOpaqueSpans(dst, pos, intersection);
     }
 }
 
 void Window::Move( Vector2<int> dst_pos, const RectAngle<int>& src )
 {
-    m_ShadowBuffer.Move( dst_pos, src );
+    m_Surface.Move( dst_pos, src );
+    MarkDirty();
 }
 
 
 void Window::SetTransparentColor(const std::optional<PixelColor> &c)
 {
-    m_TransparentColor = c;
+    if( c ){
+        m_TransparentKey = PackPixel(m_Surface.Config().PixelFormat, c.value());
+    }
+    else {
+        m_TransparentKey.reset();
+        m_Spans.clear();
+        m_SpanRowStart.clear();
+    }
+    MarkDirty();
 }
 
-Window::WindowWriter *Window::Writer()
+void Window::SetAlphaBlending(bool enable)
 {
-    return &m_Writer;
+    m_AlphaBlending = enable;
 }
 
-PixelColor &Window::At(int x, int y)
+Window::WindowWriter *Window::Writer()
 {
-    return m_Data[y][x];
+    return &m_Writer;
 }
 
-const PixelColor Window::At(int x, int y) const
+PixelColor Window::At(int x, int y) const
 {
-    return m_Data[y][x];
+    return UnpackPixel(m_Surface.Config().PixelFormat, m_Surface.NativePixel(x, y));
 }
 
 void Window::Write(Vector2<int> pos, PixelColor c)
 {
-    m_Data[pos.y][pos.x] = c;
-    m_ShadowBuffer.Writer().Write(pos.x, pos.y, c);
+    Write(pos.x, pos.y, c);
 }
 
 void Window::Write(int x, int y, PixelColor c)
 {
-    m_Data[y][x] = c;
-    m_ShadowBuffer.Writer().Write(x, y, c);
+    if( 0 <= x && x < m_Width && 0 <= y && y < m_Height ){
+        m_Surface.NativePixel(x, y) = PackPixel(m_Surface.Config().PixelFormat, c);
+        MarkDirty();
+    }
+}
+
+void Window::FillRect(Vector2<int> pos, Vector2<int> size, const PixelColor &c)
+{
+    m_Surface.Fill({pos, size}, c);
+    MarkDirty();
+}
+
+void Window::FillRect(Vector2<int> pos, Vector2<int> size, const PixelColor &c, uint8_t alpha)
+{
+    m_Surface.Fill({pos, size}, PackPremultiplied(m_Surface.Config().PixelFormat, c, alpha));
+    MarkDirty();
+}
+
+void Window::Blit(int x, int y, const uint32_t *src, int stride, int w, int h)
+{
+    m_Surface.Writer().Blit(x, y, src, stride, w, h);
+    MarkDirty();
+}
+
+void Window::BlitTransparent(int x, int y, const uint32_t *src, int stride, int w, int h, uint32_t key)
+{
+    m_Surface.Writer().BlitTransparent(x, y, src, stride, w, h, key);
+    MarkDirty();
+}
+
+void Window::RebuildOpaqueSpans()
+{
+    const uint32_t key = m_TransparentKey.value();
+
+    m_Spans.clear();
+    m_SpanRowStart.resize(m_Height + 1);
+    for( int y = 0; y < m_Height; ++y ){
+        m_SpanRowStart[y] = m_Spans.size();
+        const uint32_t* line = &m_Surface.NativePixel(0, y);
+        int x = 0;
+        while( x < m_Width ){
+            while( x < m_Width && line[x] == key ){
+                ++x;
+            }
+            const int start = x;
+            while( x < m_Width && line[x] != key ){
+                ++x;
+            }
+            if( x > start ){
+                m_Spans.push_back({start, x - start});
+            }
+        }
+    }
+    m_SpanRowStart[m_Height] = m_Spans.size();
+    m_SpansDirty = false;
+}
+
+void Window::DrawOpaqueSpans(FrameBuffer &dst, Vector2<int> pos, const RectAngle<int> &area)
+{
+    if( m_SpansDirty ){
+        RebuildOpaqueSpans();
+    }
+
+    const auto& dst_config = dst.Config();
+    const RectAngle<int> dst_outline{{0, 0}, {static_cast<int>(dst_config.HorizontalResolution),
+                                              static_cast<int>(dst_config.VerticalResolution)}};
+    const auto draw_area = area.Intersection(dst_outline);
+
+    // ウィンドウ座標での描画範囲
+    const int x0 = draw_area.pos.x - pos.x;
+    const int x1 = x0 + draw_area.size.x;
+    const int y0 = draw_area.pos.y - pos.y;
+    const int y1 = y0 + draw_area.size.y;
+
+    for( int y = y0; y < y1; ++y ){
+        for( uint32_t i = m_SpanRowStart[y]; i < m_SpanRowStart[y + 1]; ++i ){
+            const int start = std::max(m_Spans[i].Start, x0);
+            const int end   = std::min(m_Spans[i].Start + m_Spans[i].Length, x1);
+            if( start < end ){
+                blit::CopyRow(&dst.NativePixel(pos.x + start, pos.y + y),
+                              &m_Surface.NativePixel(start, y), end - start, false);
+            }
+        }
+    }
 }
 
 int Window::Width() const
@@ -174,8 +251,8 @@ Vector2<int> Window::Size() const
     return Vector2<int>{m_Width, m_Height};
 }
 
-TopLevelWindow::TopLevelWindow(int width, int height, PixelFormat shadow_format, const std::string &title)
-    : Window(width, height, shadow_format),
+TopLevelWindow::TopLevelWindow(int width, int height, PixelFormat format, const std::string &title)
+    : Window(width, height, format),
       m_Title(title),
       m_InnerWriter(*this)
 {
@@ -233,6 +310,8 @@ void DrawWindowTitle( IPixelWriter &writer, const char *title, bool active )
     FillRectAngle(writer, {3, 3}, {win_w - 6, 18}, ToColor(bgcolor));
     WriteString(writer, 24, 4, title, ToColor(0xffffff));
 
+    const auto format = writer.Format();
+    uint32_t image[kCloseButtonHeight][kCloseButtonWidth];
     for( int y = 0; y < kCloseButtonHeight; ++y ){
         for( int x = 0; x < kCloseButtonWidth; ++x ){
             PixelColor c = ToColor(0xffffff);
@@ -245,9 +324,10 @@ void DrawWindowTitle( IPixelWriter &writer, const char *title, bool active )
             else if( close_button[y][x] == ':' ){
                 c = ToColor(0xc6c6c6);
             }
-            writer.Write(win_w - 5 - kCloseButtonWidth + x, 5 + y, c);
+            image[y][x] = PackPixel(format, c);
         }
     }
+    writer.Blit(win_w - 5 - kCloseButtonWidth, 5, &image[0][0], kCloseButtonWidth, kCloseButtonWidth, kCloseButtonHeight);
 }
 
 void DrawTextBox( IPixelWriter& writer, Vector2<int> pos, Vector2<int> size ) 
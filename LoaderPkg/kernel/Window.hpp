@@ -24,8 +24,25 @@ public:
         {
             m_Window.Write( x, y, c );
         }
+        virtual void FillRect( int x, int y, int w, int h, const PixelColor& c ) override
+        {
+            m_Window.FillRect( {x, y}, {w, h}, c );
+        }
+        virtual void WriteSpan( int x, int y, const uint32_t* pixels, int n ) override
+        {
+            m_Window.Blit( x, y, pixels, n, n, 1 );
+        }
+        virtual void Blit( int x, int y, const uint32_t* src, int stride, int w, int h ) override
+        {
+            m_Window.Blit( x, y, src, stride, w, h );
+        }
+        virtual void BlitTransparent( int x, int y, const uint32_t* src, int stride, int w, int h, uint32_t key ) override
+        {
+            m_Window.BlitTransparent( x, y, src, stride, w, h, key );
+        }
         virtual int Width() const override { return m_Window.Width(); }
         virtual int Height() const override { return m_Window.Height(); }
+        virtual PixelFormat Format() const override { return m_Window.Format(); }
 
     private:
 
@@ -33,7 +50,7 @@ public:
     };
 
     //! @brief 指定されたピクセル数の平面描写領域を作成する
-    Window( int width, int height, PixelFormat shadow_format );
+    Window( int width, int height, PixelFormat format );
     virtual ~Window() = default;
 
     Window( const Window& ) = delete;
@@ -56,17 +73,30 @@ public:
 
     //! @brief 透過色を設定する
     void SetTransparentColor( const std::optional<PixelColor>& c );
+    /**
+     * @brief ピクセルごとの不透明度を使って下のレイヤーと重ねるか設定する
+     *        有効な間，描画内容は α 乗算済みで上位 8bit を透明度 (255 - α) として扱う
+     *        通常の描画関数で書いたピクセルは不透明になる
+     */
+    void SetAlphaBlending( bool enable );
+    //! @brief 透過色も不透明度も使わず，ウィンドウ全体が下のレイヤーを完全に隠すか
+    bool IsOpaque() const { return !m_TransparentKey && !m_AlphaBlending; }
     //! @brief このインスタンスに紐づいた WindowWriter を取得する。
     virtual Window::WindowWriter* Writer();
 
     //! @brief 指定した位置のピクセルを返す
-    PixelColor& At( int x, int y );
-    //! @brief 指定した位置のピクセルを返す
-    const PixelColor At( int x, int y ) const;
+    PixelColor At( int x, int y ) const;
 
     //! @brief 指定した位置にピクセルを書き込む
     void Write( Vector2<int> pos, PixelColor c );
     void Write( int x, int y, PixelColor c );
+    //! @brief 矩形領域を指定色で塗りつぶす
+    void FillRect( Vector2<int> pos, Vector2<int> size, const PixelColor& c );
+    //! @brief 矩形領域を不透明度 alpha の色で塗りつぶす (SetAlphaBlending で有効にしたウィンドウ向け)
+    void FillRect( Vector2<int> pos, Vector2<int> size, const PixelColor& c, uint8_t alpha );
+    //! @brief ネイティブ形式のピクセル列を書き込む (IPixelWriter::Blit と同じ)
+    void Blit( int x, int y, const uint32_t* src, int stride, int w, int h );
+    void BlitTransparent( int x, int y, const uint32_t* src, int stride, int w, int h, uint32_t key );
 
     //! @brief 平面描写領域の横幅をピクセル単位で返す
     int Width() const;
@@ -74,18 +104,42 @@ public:
     int Height() const;
     //! @brief 平面描写領域のサイズを返す
     Vector2<int> Size() const;
+    //! @brief 平面描写領域のピクセル形式を返す
+    PixelFormat Format() const { return m_Surface.Config().PixelFormat; }
 
     virtual void Activate() {}
     virtual void Deactivate() {}
 
 private:
 
+    //! @brief 透過色を持つウィンドウの1行中で，透過色でないピクセルが連続する区間
+    struct OpaqueSpan
+    {
+        int Start;
+        int Length;
+    };
+
+    //! @brief 描画内容が変わったことを記録する。OpaqueSpan は次の DrawTo で作り直す
+    void MarkDirty() { m_SpansDirty = true; }
+    //! @brief m_Surface から OpaqueSpan を作り直す
+    void RebuildOpaqueSpans();
+    //! @brief OpaqueSpan を使って透過色以外の部分だけを dst にコピーする
+    void DrawOpaqueSpans( FrameBuffer& dst, Vector2<int> pos, const RectAngle<int>& area );
+
     int m_Width, m_Height;
-    std::vector<std::vector<PixelColor>> m_Data;
     WindowWriter m_Writer;
-    std::optional<PixelColor> m_TransparentColor;
-
-    FrameBuffer m_ShadowBuffer;
+    //! 透過色(フレームバッファのネイティブ形式)
+    std::optional<uint32_t> m_TransparentKey;
+    //! ピクセルごとの不透明度で重ねるか
+    bool m_AlphaBlending;
+
+    //! y 行目の OpaqueSpan は m_Spans[m_SpanRowStart[y]] から m_Spans[m_SpanRowStart[y+1]] の手前まで
+    std::vector<OpaqueSpan> m_Spans;
+    std::vector<uint32_t>   m_SpanRowStart;
+    bool m_SpansDirty;
+
+    //! ウィンドウの描画内容 フレームバッファと同じピクセル形式で1枚だけ持つ
+    FrameBuffer m_Surface;
 };
 
 class TopLevelWindow : public Window
@@ -102,6 +156,19 @@ public:
         virtual void Write( uint32_t x, uint32_t y, const PixelColor& c ) override {
             m_Window.Write( x + k_TopLeftMargin.x, y + k_TopLeftMargin.y, c );
         }
+        virtual void FillRect( int x, int y, int w, int h, const PixelColor& c ) override {
+            m_Window.FillRect( Vector2<int>{x, y} + k_TopLeftMargin, {w, h}, c );
+        }
+        virtual void WriteSpan( int x, int y, const uint32_t* pixels, int n ) override {
+            m_Window.Blit( x + k_TopLeftMargin.x, y + k_TopLeftMargin.y, pixels, n, n, 1 );
+        }
+        virtual void Blit( int x, int y, const uint32_t* src, int stride, int w, int h ) override {
+            m_Window.Blit( x + k_TopLeftMargin.x, y + k_TopLeftMargin.y, src, stride, w, h );
+        }
+        virtual void BlitTransparent( int x, int y, const uint32_t* src, int stride, int w, int h, uint32_t key ) override {
+            m_Window.BlitTransparent( x + k_TopLeftMargin.x, y + k_TopLeftMargin.y, src, stride, w, h, key );
+        }
+        virtual PixelFormat Format() const override { return m_Window.Format(); }
         virtual int Width() const override {
             return m_Window.Width() - k_TopLeftMargin.x - k_BottomRightMargin.x;
         }
@@ -112,7 +179,7 @@ public:
         TopLevelWindow& m_Window;
     };
 
-    TopLevelWindow( int width, int height, PixelFormat shadow_format, const std::string& title );
+    TopLevelWindow( int width, int height, PixelFormat format, const std::string& title );
     virtual void Activate() override;
     virtual void Deactivate() override;
 
@@ -0,0 +1,105 @@
+//
+// include files
+//
+#include <array>
+
+#include "WorkQueue.hpp"
+#include "Task.hpp"
+#include "CPU.hpp"
+#include "InterruptGuard.hpp"
+
+//
+// static variables
+//
+namespace
+{
+    /**
+     * @brief CPU毎のワークキュー
+     *        登録は CAS による単方向リストへの push、取り出しはワーカーが
+     *        リスト全体を exchange で奪うので、どちらもロック不要
+     */
+    struct WorkQueue
+    {
+        std::atomic<WorkItem*> Head;
+        Task* Worker;
+    };
+
+    std::array<WorkQueue, k_MaxCPUs> s_Queues;
+}
+
+//
+// funcion definitions
+// 
+bool WorkItem::Pending() const
+{
+    return m_Pending.load( std::memory_order_acquire );
+}
+
+void InitializeWorkQueue()
+{
+    InterruptGuard guard;
+
+    for( uint32_t cpu = 0; cpu < s_Queues.size(); ++cpu ){
+        Task& worker = TaskManager::Instance()
+            .NewTask()
+            .InitContext( TaskWorker, cpu );
+        s_Queues[cpu].Head.store( nullptr, std::memory_order_relaxed );
+        s_Queues[cpu].Worker = &worker;
+        TaskManager::Instance().Wakeup( &worker, k_WorkerTaskLevel );
+    }
+}
+
+bool QueueWork( WorkItem& item )
+{
+    if( item.m_Pending.exchange( true, std::memory_order_acq_rel ) ){
+        return false;
+    }
+
+    WorkQueue& queue = s_Queues[CurrentCPU()];
+    WorkItem* head = queue.Head.load( std::memory_order_relaxed );
+    do {
+        item.m_Next = head;
+    } while( !queue.Head.compare_exchange_weak( head, &item, 
+                std::memory_order_release, std::memory_order_relaxed ) );
+
+    if( queue.Worker ){
+        InterruptGuard guard;
+        TaskManager::Instance().Wakeup( queue.Worker );
+    }
+    return true;
+}
+
+void TaskWorker( uint64_t task_id, int64_t data )
+{
+    WorkQueue& queue = s_Queues[data];
+    Task& task = TaskManager::Instance().CurrentTask();
+
+    while(1){
+        WorkItem* list = queue.Head.exchange( nullptr, std::memory_order_acquire );
+        if( list == nullptr ){
+            // 判定からスリープまでの間に登録されると起床を取りこぼすので割り込みを止める
+            InterruptGuard guard;
+            if( queue.Head.load( std::memory_order_relaxed ) == nullptr ){
+                task.Sleep();
+            }
+            continue;
+        }
+
+        // push 順の逆になっているので、登録順に並べ直す
+        WorkItem* ordered = nullptr;
+        while( list ){
+            WorkItem* next = list->m_Next;
+            list->m_Next = ordered;
+            ordered = list;
+            list = next;
+        }
+
+        while( ordered ){
+            WorkItem* item = ordered;
+            ordered = item->m_Next;
+            // 実行中の再登録は次回に回すため、実行前に解除する
+            item->m_Pending.store( false, std::memory_order_release );
+            item->m_Func( item->m_Arg );
+        }
+    }
+}
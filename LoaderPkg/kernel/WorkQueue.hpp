@@ -0,0 +1,64 @@
+#pragma once
+
+// 
+// include headers
+//
+#include <cstdint>
+#include <atomic>
+
+#include "Task.hpp"
+
+/**
+ * @brief 割り込みハンドラから後回しにする処理の単位
+ *        静的に確保して使い回す。実行待ちの間に再度登録されても
+ *        二重には登録されず、1回の実行にまとめられる
+ */
+class WorkItem
+{
+public:
+    using Func = void( uint64_t arg );
+
+    // 静的変数として定数初期化できるよう constexpr にする
+    constexpr WorkItem( Func* func, uint64_t arg = 0 )
+        : m_Func( func ),
+          m_Arg( arg ),
+          m_Pending( false ),
+          m_Next( nullptr )
+    {}
+    WorkItem( const WorkItem& ) = delete;
+    WorkItem& operator=( const WorkItem& ) = delete;
+
+    //! @brief 実行待ちか
+    bool Pending() const;
+
+private:
+
+    friend bool QueueWork( WorkItem& item );
+    friend void TaskWorker( uint64_t task_id, int64_t data );
+
+    Func* m_Func;
+    uint64_t m_Arg;
+    std::atomic<bool> m_Pending;
+    WorkItem* m_Next;
+};
+
+//
+// constants
+//
+//! @brief ワーカータスクの実行レベル。メインタスクや合成タスクよりも優先して実行する
+constexpr int k_WorkerTaskLevel = TaskManager::k_MaxLevel;
+
+// 
+// functions
+//
+//! @brief ワーカータスクを生成する。タスク管理の初期化後に呼ぶこと
+void InitializeWorkQueue();
+
+/**
+ * @brief 実行中CPUのワークキューに登録し、ワーカータスクを起床する
+ *        割り込みハンドラからも呼び出せる
+ * @return 新たに登録したら true、既に実行待ちでまとめられたら false
+ */
+bool QueueWork( WorkItem& item );
+
+void TaskWorker( uint64_t task_id, int64_t data );
@@ -21,6 +21,20 @@ IoIn32:
     in  eax, dx
     ret
 
+global IoOut8  ; void IoOut8( uint16_t addr, uint8_t data );
+IoOut8:
+    mov dx, di      ; dx = addr
+    mov al, sil     ; al = data
+    out dx, al
+    ret
+
+global IoIn8    ; uint8_t IoIn8( uint16_t addr );
+IoIn8:
+    mov dx, di      ; dx = addr
+    xor eax, eax
+    in  al, dx
+    ret
+
 global GetCS  ; uint16_t GetCS(void);
 GetCS:
     xor eax, eax  ; also clears upper 32 bits of rax
@@ -92,6 +106,13 @@ global GetCR3 ; uint64_t GetCR3()
 GetCR3:
     mov rax, cr3
     ret
+
+global ReadTSC ; uint64_t ReadTSC()
+ReadTSC:
+    rdtsc
+    shl rdx, 32
+    or  rax, rdx
+    ret
     
 global SwitchContext
 SwitchContext:  ; void SwitchContext(void* next_ctx, void* current_ctx);
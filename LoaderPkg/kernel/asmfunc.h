@@ -5,6 +5,8 @@
 extern "C" {
     void IoOut32( uint16_t addr, uint32_t data );
     uint32_t IoIn32( uint16_t addr );
+    void IoOut8( uint16_t addr, uint8_t data );
+    uint8_t IoIn8( uint16_t addr );
     uint16_t GetCS( void );
     void LoadIDT( uint16_t limit, uint64_t offset );
     void LoadGDT( uint16_t limit, uint64_t offset );
@@ -12,5 +14,6 @@ extern "C" {
     void SetCSSS( uint16_t cs, uint16_t ss );
     void SetCR3( uint64_t value );
     uint64_t GetCR3();
+    uint64_t ReadTSC();
     void SwitchContext( void* next_ctx, void* current_ctx );
 }
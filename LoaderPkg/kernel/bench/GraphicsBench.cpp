@@ -0,0 +1,380 @@
+/**
+ * @file GraphicsBench.cpp
+ *
+ * FrameBuffer / Window / LayerManager をホスト上で動かすマイクロベンチマーク．
+ * 画面は malloc したメモリを VRAM に見立てた FrameBufferConfig で模擬する．
+ * 結果は 1 ベンチマークにつき 1 行の JSON として標準出力に出す．
+ *
+ * usage: graphics_bench [-w width] [-h height] [-t min_seconds] [name_filter]
+ */
+
+//
+// include files
+//
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "FrameBuffer.hpp"
+#include "Window.hpp"
+#include "Layer.hpp"
+#include "Font.hpp"
+#include "BlitKernel.hpp"
+
+#include "KernelStubs.hpp"
+
+//
+// constant
+//
+namespace
+{
+    constexpr PixelFormat k_Format = kPixelBGRReserved8BitPerColor;
+    constexpr Vector2<int> k_WindowSize{ 200, 150 };
+    //! 合成ベンチマークで重ねるウィンドウ数
+    constexpr int k_CompositeWindowCounts[] = { 4, 16, 64 };
+    //! 文字描画ベンチマークの行数・桁数 (Console と同じ)
+    constexpr int k_TextRows    = 25;
+    constexpr int k_TextColumns = 80;
+}
+
+//
+// static variables
+//
+namespace
+{
+    Vector2<int> s_ScreenSize{ 1024, 768 };
+    double s_MinSeconds = 0.2;
+    const char* s_Filter = nullptr;
+}
+
+//
+// static function declaration
+//
+namespace
+{
+    struct Screen;
+    std::unique_ptr<Screen> MakeScreen();
+    void InitializeBuffer( FrameBuffer& fb, Vector2<int> size );
+    void ReportFrame( std::string& extra );
+    std::shared_ptr<Window> MakeWindow( int index );
+    void BuildScene( LayerManager& manager, int windows );
+
+    template <class F>
+    void Run( const char* name, uint64_t pixels_per_iter, F&& body );
+
+    void BenchFill();
+    void BenchBlit();
+    void BenchText();
+    void BenchComposite();
+    void BenchDrag();
+}
+
+//
+// funcion definitions
+//
+namespace
+{
+    //! @brief malloc したメモリを VRAM に見立てた画面
+    struct Screen
+    {
+        std::unique_ptr<uint8_t, decltype(&free)> Memory{ nullptr, &free };
+        FrameBuffer Buffer;
+    };
+
+    std::unique_ptr<Screen> MakeScreen()
+    {
+        auto screen = std::make_unique<Screen>();
+        screen->Memory.reset( static_cast<uint8_t*>( malloc( 4ul * s_ScreenSize.x * s_ScreenSize.y ) ) );
+
+        FrameBufferConfig config{};
+        config.FrameBuffer          = screen->Memory.get();
+        config.PixelsPerScanLine    = s_ScreenSize.x;
+        config.HorizontalResolution = s_ScreenSize.x;
+        config.VerticalResolution   = s_ScreenSize.y;
+        config.PixelFormat          = k_Format;
+        screen->Buffer.Initialize( config );
+        screen->Buffer.Fill( {{0, 0}, s_ScreenSize}, PixelColor{0, 0, 0} );
+        return screen;
+    }
+
+    //! @brief 自前のメモリを持つ(ウィンドウやバックバッファと同じ)バッファを用意する
+    void InitializeBuffer( FrameBuffer& fb, Vector2<int> size )
+    {
+        FrameBufferConfig config{};
+        config.HorizontalResolution = size.x;
+        config.VerticalResolution   = size.y;
+        config.PixelFormat          = k_Format;
+        fb.Initialize( config );
+    }
+
+    //! @brief 最後に合成したフレームの統計を JSON のフィールドとして extra に加える
+    void ReportFrame( std::string& extra )
+    {
+        const auto& frame = LastFrameStats();
+        char s[160];
+        snprintf( s, sizeof(s),
+                  ",\"pixels_composited\":%lu,\"bytes_to_screen\":%lu,\"draw_calls\":%u,\"layers_visited\":%u,\"damage_rects\":%u",
+                  static_cast<unsigned long>(frame.PixelsComposited), static_cast<unsigned long>(frame.BytesToScreen),
+                  frame.DrawCalls, frame.LayersVisited, frame.DamageRects );
+        extra += s;
+    }
+
+    /**
+     * @brief 合成ベンチマーク用のウィンドウ
+     *        4 枚に 1 枚は透過色付き，4 枚に 1 枚は半透明にして，合成の各経路を通す
+     */
+    std::shared_ptr<Window> MakeWindow( int index )
+    {
+        auto window = std::make_shared<Window>( k_WindowSize.x, k_WindowSize.y, k_Format );
+        const uint8_t shade = static_cast<uint8_t>( 64 + (index * 37) % 160 );
+
+        switch( index % 4 ){
+        case 1:
+            window->SetTransparentColor( PixelColor{0, 0, 1} );
+            window->FillRect( {0, 0}, k_WindowSize, {0, 0, 1} );
+            window->FillRect( {8, 8}, k_WindowSize - Vector2<int>{16, 16}, {shade, 0, shade} );
+            break;
+        case 3:
+            window->SetAlphaBlending( true );
+            window->FillRect( {0, 0}, k_WindowSize, {0, shade, shade}, 128 );
+            break;
+        default:
+            DrawWindow( *window->Writer(), "bench" );
+            break;
+        }
+        return window;
+    }
+
+    //! @brief 画面全体の背景と，少しずつずらして重ねた windows 枚のウィンドウを並べる
+    void BuildScene( LayerManager& manager, int windows )
+    {
+        auto background = std::make_shared<Window>( s_ScreenSize.x, s_ScreenSize.y, k_Format );
+        DrawDesktop( *background->Writer() );
+
+        int height = 0;
+        const auto bg_id = manager.NewLayer().SetWindow( background ).Move( {0, 0} ).ID();
+        manager.UpDown( bg_id, height++ );
+
+        const Vector2<int> span = s_ScreenSize - k_WindowSize;
+        for( int i = 0; i < windows; ++i ){
+            const Vector2<int> pos{ (i * 53) % std::max( span.x, 1 ), (i * 31) % std::max( span.y, 1 ) };
+            const auto id = manager.NewLayer().SetWindow( MakeWindow( i ) ).SetDraggable( true ).Move( pos ).ID();
+            manager.UpDown( id, height++ );
+        }
+    }
+
+    /**
+     * @brief body を s_MinSeconds 以上繰り返し，1 回あたりの時間を 1 行の JSON で出力する
+     * @param pixels_per_iter  1 回で処理するピクセル数 (スループットの計算に使う)
+     */
+    template <class F>
+    void Run( const char* name, uint64_t pixels_per_iter, F&& body )
+    {
+        using Clock = std::chrono::steady_clock;
+
+        if( s_Filter && !strstr( name, s_Filter ) ){
+            return;
+        }
+
+        // キャッシュ・分岐予測を温めるために 1 回空回しする
+        body();
+
+        uint64_t iterations = 0;
+        uint64_t batch = 1;
+        double seconds = 0;
+        const auto start = Clock::now();
+        while( seconds < s_MinSeconds ){
+            for( uint64_t i = 0; i < batch; ++i ){
+                body();
+            }
+            iterations += batch;
+            batch = std::min<uint64_t>( batch * 2, 1024 );
+            seconds = std::chrono::duration<double>( Clock::now() - start ).count();
+        }
+
+        const double ns_per_iter = seconds * 1e9 / iterations;
+        const double mpixels_per_sec = pixels_per_iter * iterations / seconds / 1e6;
+        printf( "{\"name\":\"%s\",\"kernel\":\"%s\",\"width\":%d,\"height\":%d,"
+                "\"iterations\":%lu,\"ns_per_iter\":%.1f,\"pixels_per_iter\":%lu,\"mpixels_per_sec\":%.1f}\n",
+                name, blit::KernelName(), s_ScreenSize.x, s_ScreenSize.y,
+                static_cast<unsigned long>(iterations), ns_per_iter,
+                static_cast<unsigned long>(pixels_per_iter), mpixels_per_sec );
+        fflush( stdout );
+    }
+
+    void BenchFill()
+    {
+        const uint64_t pixels = static_cast<uint64_t>(s_ScreenSize.x) * s_ScreenSize.y;
+        const RectAngle<int> full{ {0, 0}, s_ScreenSize };
+        uint8_t shade = 0;
+
+        auto screen = MakeScreen();
+        Run( "fill_screen", pixels, [&]{ screen->Buffer.Fill( full, PixelColor{++shade, 0, 0} ); } );
+
+        FrameBuffer buffer;
+        InitializeBuffer( buffer, s_ScreenSize );
+        Run( "fill_buffer", pixels, [&]{ buffer.Fill( full, PixelColor{0, ++shade, 0} ); } );
+
+        // ウィンドウ内の小さな矩形 (ボタンや文字の背景程度)
+        Window window( k_WindowSize.x, k_WindowSize.y, k_Format );
+        Run( "fill_window_small", 16 * 16, [&]{ window.FillRect( {shade % 64, 8}, {16, 16}, {0, 0, ++shade} ); } );
+    }
+
+    void BenchBlit()
+    {
+        const uint64_t pixels = static_cast<uint64_t>(s_ScreenSize.x) * s_ScreenSize.y;
+        const RectAngle<int> full{ {0, 0}, s_ScreenSize };
+
+        FrameBuffer src;
+        InitializeBuffer( src, s_ScreenSize );
+        src.Fill( full, PixelColor{10, 20, 30} );
+        src.Fill( {{0, 0}, {s_ScreenSize.x / 2, s_ScreenSize.y}}, PixelColor{0, 0, 1} );
+
+        auto screen = MakeScreen();
+        Run( "blit_to_screen", pixels, [&]{ screen->Buffer.Copy( {0, 0}, src, full ); } );
+
+        FrameBuffer dst;
+        InitializeBuffer( dst, s_ScreenSize );
+        Run( "blit_buffer", pixels, [&]{ dst.Copy( {0, 0}, src, full ); } );
+
+        const uint32_t key = PackPixel( k_Format, {0, 0, 1} );
+        Run( "blit_keyed", pixels, [&]{ dst.CopyTransparent( {0, 0}, src, full, key ); } );
+
+        FrameBuffer translucent;
+        InitializeBuffer( translucent, s_ScreenSize );
+        translucent.Fill( full, PackPremultiplied( k_Format, {200, 100, 50}, 128 ) );
+        Run( "blit_blend", pixels, [&]{ dst.CopyBlend( {0, 0}, translucent, full ); } );
+
+        Run( "scroll_screen", pixels, [&]{
+            screen->Buffer.Move( {0, 0}, {{0, 16}, {s_ScreenSize.x, s_ScreenSize.y - 16}} );
+        } );
+    }
+
+    void BenchText()
+    {
+        const uint64_t pixels = static_cast<uint64_t>(k_TextColumns * 8) * (k_TextRows * 16);
+        Window window( k_TextColumns * 8, k_TextRows * 16, k_Format );
+        auto writer = window.Writer();
+
+        char line[k_TextColumns + 1];
+        for( int i = 0; i < k_TextColumns; ++i ){
+            line[i] = static_cast<char>( ' ' + 1 + i % 94 );
+        }
+        line[k_TextColumns] = '\0';
+
+        Run( "text_opaque", pixels, [&]{
+            for( int row = 0; row < k_TextRows; ++row ){
+                WriteString( *writer, 0, row * 16, line, {255, 255, 255}, {0, 0, 0} );
+            }
+        } );
+        Run( "text_transparent", pixels, [&]{
+            for( int row = 0; row < k_TextRows; ++row ){
+                WriteString( *writer, 0, row * 16, line, {255, 255, 255} );
+            }
+        } );
+        Run( "text_char", 8 * 16, [&]{ WriteAscii( *writer, 0, 0, 'A', {255, 255, 255}, {0, 0, 0} ); } );
+    }
+
+    void BenchComposite()
+    {
+        const uint64_t pixels = static_cast<uint64_t>(s_ScreenSize.x) * s_ScreenSize.y;
+
+        for( int windows : k_CompositeWindowCounts ){
+            auto screen = MakeScreen();
+            LayerManager manager;
+            manager.SetWriter( &screen->Buffer );
+            BuildScene( manager, windows );
+            manager.Flush();
+
+            char name[32];
+            snprintf( name, sizeof(name), "composite_%d", windows );
+            Run( name, pixels, [&]{
+                manager.Invalidate( {{0, 0}, s_ScreenSize} );
+                manager.Flush();
+            } );
+
+            // 統計は最後のフレームのものなので，名前を分けて出力する
+            std::string extra;
+            ReportFrame( extra );
+            if( !s_Filter || strstr( name, s_Filter ) ){
+                printf( "{\"name\":\"%s_frame\"%s}\n", name, extra.c_str() );
+            }
+        }
+    }
+
+    void BenchDrag()
+    {
+        auto screen = MakeScreen();
+        LayerManager manager;
+        manager.SetWriter( &screen->Buffer );
+        BuildScene( manager, 16 );
+
+        auto window = std::make_shared<Window>( k_WindowSize.x, k_WindowSize.y, k_Format );
+        DrawWindow( *window->Writer(), "drag" );
+        const auto id = manager.NewLayer().SetWindow( window ).SetDraggable( true ).Move( {0, 0} ).ID();
+        manager.UpDown( id, std::numeric_limits<int>::max() );
+        manager.Flush();
+
+        // マウスでつかんで斜めに動かし，画面端まで来たら左上へ戻す
+        const Vector2<int> step{ 8, 6 };
+        const Vector2<int> limit = s_ScreenSize - k_WindowSize;
+        Run( "drag_window", static_cast<uint64_t>(k_WindowSize.x) * k_WindowSize.y, [&]{
+            const auto pos = manager.FindLayer( id )->GetPosition() + step;
+            if( pos.x > limit.x || pos.y > limit.y ){
+                manager.Move( id, {0, 0} );
+            }
+            else {
+                manager.MoveRelative( id, step );
+            }
+            manager.Flush();
+        } );
+
+        std::string extra;
+        ReportFrame( extra );
+        if( !s_Filter || strstr( "drag_window", s_Filter ) ){
+            printf( "{\"name\":\"drag_window_frame\"%s}\n", extra.c_str() );
+        }
+    }
+}
+
+int main( int argc, char** argv )
+{
+    for( int i = 1; i < argc; ++i ){
+        if( strcmp( argv[i], "-w" ) == 0 && i + 1 < argc ){
+            s_ScreenSize.x = atoi( argv[++i] );
+        }
+        else if( strcmp( argv[i], "-h" ) == 0 && i + 1 < argc ){
+            s_ScreenSize.y = atoi( argv[++i] );
+        }
+        else if( strcmp( argv[i], "-t" ) == 0 && i + 1 < argc ){
+            s_MinSeconds = atof( argv[++i] );
+        }
+        else if( argv[i][0] != '-' ){
+            s_Filter = argv[i];
+        }
+        else {
+            fprintf( stderr, "usage: %s [-w width] [-h height] [-t min_seconds] [name_filter]\n", argv[0] );
+            return 1;
+        }
+    }
+
+    if( s_ScreenSize.x < k_WindowSize.x || s_ScreenSize.y < k_WindowSize.y ){
+        fprintf( stderr, "screen must be at least %dx%d\n", k_WindowSize.x, k_WindowSize.y );
+        return 1;
+    }
+
+    blit::Initialize();
+
+    BenchFill();
+    BenchBlit();
+    BenchText();
+    BenchComposite();
+    BenchDrag();
+
+    return 0;
+}
@@ -0,0 +1,111 @@
+/**
+ * @file KernelStubs.cpp
+ *
+ * グラフィック関連のソースをホストでビルドするための，カーネル側シンボルの代替実装．
+ * 描画の処理そのものには関わらないものだけを置く．
+ */
+
+//
+// include files
+//
+#include <cstdarg>
+#include <cstdio>
+#include <x86intrin.h>
+
+#include "Layer.hpp"
+#include "Console.hpp"
+#include "Trace.hpp"
+#include "GfxStat.hpp"
+#include "InterruptGuard.hpp"
+#include "logger.hpp"
+#include "asmfunc.h"
+
+#include "KernelStubs.hpp"
+
+//
+// static variables
+//
+namespace
+{
+    gfxstat::FrameStats s_LastFrame;
+}
+
+//
+// global variables (Layer.cpp の CreateLayer / ActiveLayer が参照する)
+//
+LayerManager* g_LayerManager;
+ActiveLayer* g_ActiveLayer;
+Console* g_Console;
+std::shared_ptr<Window> g_MainWindow;
+int g_MainWindowLayerID;
+std::shared_ptr<TopLevelWindow> g_TextBoxWindow;
+int g_TextBoxWindowID;
+Vector2<int> g_MousePosition;
+
+//
+// funcion definitions
+//
+extern "C" uint64_t ReadTSC()
+{
+    return __rdtsc();
+}
+
+// ホストでは割り込みを扱わないので何もしない
+InterruptGuard::InterruptGuard( const char* function, int line )
+    : m_Function( function ),
+      m_Line( line ),
+      m_Restore( false ),
+      m_StartTSC( 0 ),
+      m_MaskedCycles( 0 )
+{}
+
+InterruptGuard::~InterruptGuard()
+{}
+
+void InterruptGuard::Release()
+{}
+
+int Log( LogLevel level, const char* format, ... )
+{
+    va_list ap;
+    va_start( ap, format );
+    const int result = vfprintf( stderr, format, ap );
+    va_end( ap );
+    return result;
+}
+
+namespace trace
+{
+volatile uint32_t g_EnabledMask = 0;
+
+void Write( EventType type, uint64_t arg0, uint64_t arg1 )
+{}
+}
+
+namespace gfxstat
+{
+void RecordFrame( const FrameStats& frame )
+{
+    s_LastFrame = frame;
+}
+}
+
+void Console::SetWindow( std::shared_ptr<Window> window )
+{
+    m_Window = window;
+}
+
+void Console::SetLayerID( unsigned int layer_id )
+{
+    m_LayerID = layer_id;
+}
+
+unsigned int Console::LayerID() const
+{
+    return m_LayerID;
+}
+
+const gfxstat::FrameStats& LastFrameStats()
+{
+    return s_LastFrame;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+//
+// include headers
+//
+#include "GfxStat.hpp"
+
+//! @brief LayerManager::Flush が最後に記録したフレームの統計
+const gfxstat::FrameStats& LastFrameStats();
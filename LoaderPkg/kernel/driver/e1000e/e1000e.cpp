@@ -3,10 +3,15 @@
 //
 #include <cstdint>
 #include <algorithm>
+#include <atomic>
 #include "e1000e.hpp"
 #include "Global.hpp"
 #include "MSI.hpp"
 #include "PCI.hpp"
+#include "Trace.hpp"
+#include "Task.hpp"
+#include "InterruptGuard.hpp"
+#include "WorkQueue.hpp"
 
 namespace {
 // 
@@ -303,6 +308,32 @@ void DisableInterrupt( const Context& ctx )
     RegWrite32<IMC>( ctx, t );
 }
 
+namespace
+{
+    std::atomic<uint32_t> s_PendingICR;
+    std::atomic<uint64_t> s_RxTaskID;
+
+    //! @brief 割り込み要因の処理。ワーカータスクで実行する
+    void ProcessInterrupt( uint64_t arg )
+    {
+        ICR icr { s_PendingICR.exchange( 0, std::memory_order_acq_rel ) };
+        const uint64_t task_id = s_RxTaskID.load( std::memory_order_acquire );
+
+        // 受信したフレームは待っているタスクが Context::Recv で取り出す
+        if( (icr.RXT0 || icr.RXDMT0 || icr.RXO) && task_id != 0 ){
+            InterruptGuard guard;
+            TaskManager::Instance().Wakeup( task_id );
+        }
+    }
+
+    WorkItem s_InterruptWork( ProcessInterrupt );
+}
+
+void SetRxTask( uint64_t task_id )
+{
+    s_RxTaskID.store( task_id, std::memory_order_release );
+}
+
 void InterruptHandler()
 {
     // TODO: 複数同じイーサネットアダプタが存在する場合を考慮していない。
@@ -310,11 +341,16 @@ void InterruptHandler()
         return;
     }
     uint32_t icr = RegRead32<ICR>(*g_e1000e_Ctx);
+    TRACE( trace::k_E1000EInterrupt, icr, 0 );
 
     ICR icr_w = {0xFFFFFFFF};
     RegWrite32<ICR>( *g_e1000e_Ctx, icr_w );
 
     ++g_e1000eRxIntCnt;
+
+    // 要因を貯めておき、処理はワーカータスクに任せる
+    s_PendingICR.fetch_or( icr, std::memory_order_acq_rel );
+    QueueWork( s_InterruptWork );
 }
 
 }
@@ -414,6 +414,12 @@ uint32_t ReadInterrupt( const Context& ctx );
 void DisableInterrupt( const Context& ctx );
 void InterruptHandler();
 
+/**
+ * @brief 受信割り込みの後処理としてワーカータスクが起床するタスクを設定する
+ * @param task_id 起床するタスクのID。0 なら誰も起床しない
+ */
+void SetRxTask( uint64_t task_id );
+
 }
 }
 }
\ No newline at end of file
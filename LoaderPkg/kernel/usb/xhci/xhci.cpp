@@ -6,6 +6,7 @@
 #include "PCI.hpp"
 #include "MSI.hpp"
 #include "Interrupt.hpp"
+#include "Trace.hpp"
 #include "usb/setupdata.hpp"
 #include "usb/device.hpp"
 #include "usb/descriptor.hpp"
@@ -521,6 +522,7 @@ namespace usb::xhci {
 
     Error err = MAKE_ERROR(Error::kNotImplemented);
     auto event_trb = xhc.PrimaryEventRing()->Front();
+    TRACE(trace::k_XHCIEvent, event_trb->bits.trb_type, 0);
     if (auto trb = TRBDynamicCast<TransferEventTRB>(event_trb)) {
       err = OnEvent(xhc, *trb);
     } else if (auto trb = TRBDynamicCast<PortStatusChangeEventTRB>(event_trb)) {
@@ -0,0 +1,68 @@
+#!/usr/bin/python3
+
+import argparse
+import re
+import struct
+import sys
+
+
+MAGIC = 0x4D59534B  # "KSYM"
+HEADER_FORMAT = '<IIII'
+ENTRY_FORMAT = '<QII'
+NM_PATTERN = re.compile(r'^([0-9a-fA-F]+)\s+([tTwW])\s+(.+)$')
+
+
+def parse(src: str) -> list:
+    symbols = {}
+
+    for line in src.splitlines():
+        m = NM_PATTERN.match(line)
+        if not m:
+            continue
+
+        addr = int(m.group(1), 16)
+        # 同じアドレスに複数のシンボルがある場合は最初のものを使う
+        symbols.setdefault(addr, m.group(3))
+
+    return sorted(symbols.items())
+
+
+def compile(symbols: list, size: int) -> bytes:
+    header_size = struct.calcsize(HEADER_FORMAT)
+    entry_size = struct.calcsize(ENTRY_FORMAT)
+
+    while True:
+        strtab = bytearray()
+        entries = []
+        for addr, name in symbols:
+            entries.append(struct.pack(ENTRY_FORMAT, addr, len(strtab), 0))
+            strtab += name.encode() + b'\0'
+
+        strtab_offset = header_size + entry_size * len(entries)
+        if strtab_offset + len(strtab) <= size:
+            break
+
+        # 収まらなければ名前の長いシンボルから間引く
+        longest = max(range(len(symbols)), key=lambda i: len(symbols[i][1]))
+        del symbols[longest]
+        print('warning: symbol table too large, dropped a symbol', file=sys.stderr)
+
+    header = struct.pack(HEADER_FORMAT, MAGIC, len(entries), strtab_offset, 0)
+    table = header + b''.join(entries) + bytes(strtab)
+    return table + bytes(size - len(table))
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('nm', help='path to an output of "nm -n -C", "-" for stdin')
+    parser.add_argument('-o', help='path to an output file', default='ksyms.bin')
+    parser.add_argument('-s', help='size of the .ksyms section', type=int, default=256 * 1024)
+    ns = parser.parse_args()
+
+    src = sys.stdin.read() if ns.nm == '-' else open(ns.nm).read()
+    with open(ns.o, 'wb') as out:
+        out.write(compile(parse(src), ns.s))
+
+
+if __name__ == '__main__':
+    main()